@@ -6,6 +6,7 @@
 
 #include "hello_imgui/internal/platform/ini_folder_locations.h"
 #include "hello_imgui/runner_params.h"
+#include "chunks.hpp"
 #include "http.hpp"
 #include "partial_dict.hpp"
 #include "tests.hpp"
@@ -16,45 +17,9 @@
 #include "filesystem"
 #include "fstream"
 #include "iterator"
+#include "unordered_set"
 #include <cstdio>
 
-void BackupConfig::save(SaveState* save) const noexcept {
-    assert(save);
-
-    save->save(this->time_to_backup);
-    save->save(this->local_to_keep);
-    save->save(this->remote_to_keep);
-    save->save(this->local_dir);
-}
-
-bool BackupConfig::can_load(SaveState* save) const noexcept {
-    assert(save);
-
-    if (!save->can_load(this->time_to_backup)) {
-        return false;
-    }
-    if (!save->can_load(this->local_to_keep)) {
-        return false;
-    }
-    if (!save->can_load(this->remote_to_keep)) {
-        return false;
-    }
-    if (!save->can_load(this->local_dir)) {
-        return false;
-    }
-
-    return true;
-}
-
-void BackupConfig::load(SaveState* save) noexcept {
-    assert(save);
-
-    save->load(this->time_to_backup);
-    save->load(this->local_to_keep);
-    save->load(this->remote_to_keep);
-    save->load(this->local_dir);
-}
-
 std::string BackupConfig::get_default_local_dir() const noexcept {
     return HelloImGui::IniFolderLocation(HelloImGui::IniFolderType::AppExecutableFolder) + FS_SLASH
            "backups" FS_SLASH;
@@ -64,61 +29,6 @@ std::string BackupConfig::get_local_dir() const noexcept {
     return this->local_dir.value_or(this->get_default_local_dir());
 }
 
-void UserConfig::save(SaveState* save) const noexcept {
-    assert(save);
-
-    save->save(this->sync_hostname);
-    save->save(this->sync_session.status);
-    save->save(this->sync_session.data);
-    save->save(this->sync_name);
-    save->save(this->sync_password); // Save a password clientside for future encryption
-                                     // Worry about it being in plain text?
-    save->save(this->language);
-    save->save(this->backup);
-}
-
-bool UserConfig::can_load(SaveState* save) const noexcept {
-    assert(save);
-
-    if (!save->can_load(this->sync_hostname)) {
-        return false;
-    }
-    if (!save->can_load(this->sync_session.status)) {
-        return false;
-    }
-    if (!save->can_load(this->sync_session.data)) {
-        return false;
-    }
-    if (!save->can_load(this->sync_name)) {
-        return false;
-    }
-    if (!save->can_load(this->sync_password)) {
-        return false;
-    }
-    if (!save->can_load(this->language)) {
-        return false;
-    }
-    if (save->save_version >= 2 && !save->can_load(this->backup)) {
-        return false;
-    }
-
-    return true;
-}
-
-void UserConfig::load(SaveState* save) noexcept {
-    assert(save);
-
-    save->load(this->sync_hostname);
-    save->load(this->sync_session.status);
-    save->load(this->sync_session.data);
-    save->load(this->sync_name);
-    save->load(this->sync_password);
-    save->load(this->language);
-    if (save->save_version >= 2) {
-        save->load(this->backup);
-    }
-}
-
 void UserConfig::open_file() noexcept {
     std::string filename =
         HelloImGui::IniFolderLocation(HelloImGui::IniFolderType::AppUserConfigFolder) +
@@ -133,7 +43,7 @@ void UserConfig::open_file() noexcept {
     SaveState save{};
     if (!save.read(in) || !save.can_load(*this) || save.load_idx != save.original_size) {
         Log(LogLevel::Error,
-            "Failed to read user config in '%s', likely file is invalid or size exceeds maximum",
+            "Failed to read user config in '%s', likely file is invalid",
             filename.c_str());
         Log(LogLevel::Warning, "Copying the old user config file, and creating a new one");
 
@@ -212,46 +122,17 @@ const Group* AppState::root_group() const noexcept {
     return &std::get<Group>(this->tests.at(0));
 }
 
-bool AppState::is_running_tests() const noexcept {
-    for (const auto& [id, results] : this->test_results) {
-        for (const auto& result : results) {
-            if (result.running.load()) {
-                return true;
-            }
-        }
-    }
+bool AppState::is_running_tests() const noexcept { return this->run_counters->running(); }
 
-    return false;
-}
-
-void AppState::save(SaveState* save) const noexcept {
-    assert(save);
-
-    // This save is obviously going to be pretty big so reserve instantly for speed
-    save->original_buffer.reserve(4096);
-
-    save->save(this->id_counter);
-    save->save(this->tests);
-}
-
-bool AppState::can_load(SaveState* save) const noexcept {
-    assert(save);
-
-    if (!save->can_load(this->id_counter)) {
-        return false;
-    }
-    if (!save->can_load(this->tests)) {
-        return false;
+bool AppState::is_busy() noexcept {
+    if (this->is_running_tests() || this->thr_pool.get_tasks_total() > 0 ||
+        this->format_thr_pool.get_tasks_total() > 0 || this->backup.running.load()) {
+        return true;
     }
 
-    return true;
-}
-
-void AppState::load(SaveState* save) noexcept {
-    assert(save);
-
-    save->load(this->id_counter);
-    save->load(this->tests);
+    // Last results of a run can still be waiting for results_update
+    std::lock_guard<std::mutex> lock(this->result_events_mutex);
+    return !this->result_events.empty() || !this->result_tokens.empty();
 }
 
 void AppState::editor_open_tab(size_t id) noexcept {
@@ -274,6 +155,7 @@ void AppState::focus_diff_tests(std::unordered_map<size_t, NestedTest>* old_test
 
     for (auto& [id, test] : this->tests) {
         if (old_tests->contains(id) && !nested_test_eq(&test, &old_tests->at(id))) {
+            this->search.changed.insert(id);
             this->editor_open_tab(id);
         } else {
             if (std::holds_alternative<Test>(test)) {
@@ -284,9 +166,14 @@ void AppState::focus_diff_tests(std::unordered_map<size_t, NestedTest>* old_test
 }
 
 void AppState::post_open() noexcept {
+    this->search.rebuild = true;
     this->editor.open_tabs.clear();
     this->tree_view.selected_tests.clear();
     this->undo_history.reset_undo_history(this);
+
+    // Opened file is already saved, no need to back it up until it's changed
+    this->backup.local_generation.store(this->undo_history.generation);
+    this->backup.remote_generation.store(this->undo_history.generation);
 }
 
 void AppState::post_undo() noexcept {
@@ -618,6 +505,7 @@ void AppState::copy() noexcept {
     }
 
     this->clipboard = {};
+    this->clipboard.reserve(to_copy);
     this->clipboard.save(to_copy);
     this->clipboard.finish_save();
 }
@@ -738,34 +626,188 @@ void AppState::sort(Group& group) noexcept {
               [this](size_t a, size_t b) { return test_comp(this->tests, a, b); });
 }
 
-bool AppState::filter(Group& group) noexcept {
-    bool result = true;
-    for (size_t child_id : group.children_ids) {
-        result &= this->filter(&this->tests[child_id]);
+void AppState::filter() noexcept {
+    search_update(this);
+
+    // Matching tests and every group above them stay visible
+    std::unordered_set<size_t> visible;
+    for (const SearchMatch& match : this->search.index.search(
+             this->tree_view.filter, SEARCH_KIND_NAME | SEARCH_KIND_ENDPOINT)) {
+        for (size_t id = match.id; this->tests.contains(id) && !visible.contains(id);) {
+            visible.insert(id);
+            if (id == 0) {
+                break;
+            }
+            id = std::visit(ParentIDVisitor(), this->tests.at(id));
+        }
     }
-    result &= !str_contains(group.name, this->tree_view.filter);
 
-    if (result) {
-        group.flags &= ~GROUP_OPEN;
+    this->tree_view.filtered_tests.clear();
+    for (auto& [id, nt] : this->tests) {
+        bool filtered = !visible.contains(id);
+        if (filtered) {
+            this->tree_view.filtered_tests.insert(id);
+        }
+
+        if (std::holds_alternative<Group>(nt)) {
+            Group& group = std::get<Group>(nt);
+            if (filtered) {
+                group.flags &= ~GROUP_OPEN;
+            } else {
+                group.flags |= GROUP_OPEN;
+            }
+        }
+    }
+}
+
+static std::vector<SearchField> search_fields(const NestedTest& nt) noexcept {
+    std::vector<SearchField> result;
+
+    if (std::holds_alternative<Group>(nt)) {
+        result.push_back({.kind = SEARCH_NAME, .text = std::get<Group>(nt).name});
+        return result;
+    }
+
+    const Test& test = std::get<Test>(nt);
+    result.push_back({.kind = SEARCH_ENDPOINT, .text = test.endpoint});
+
+    for (const HeadersElement& header : test.request.headers.elements) {
+        result.push_back({
+            .kind = SEARCH_HEADER,
+            .text = header.key.str() + ": " + header.data.data,
+        });
+    }
+    for (const ParametersElement& param : test.request.parameters.elements) {
+        result.push_back({
+            .kind = SEARCH_PARAMETER,
+            .text = param.key.str() + "=" + param.data.data,
+        });
+    }
+
+    if (std::holds_alternative<std::string>(test.request.body)) {
+        const std::string& body = std::get<std::string>(test.request.body);
+        if (!body.empty()) {
+            result.push_back({.kind = SEARCH_BODY, .text = body});
+        }
     } else {
-        group.flags |= GROUP_OPEN;
+        const MultiPartBody& multipart = std::get<MultiPartBody>(test.request.body);
+        for (const MultiPartBodyElement& elem : multipart.elements) {
+            if (std::holds_alternative<std::string>(elem.data.data)) {
+                result.push_back({
+                    .kind = SEARCH_BODY,
+                    .text = elem.key.str() + "=" + std::get<std::string>(elem.data.data),
+                });
+            }
+        }
+    }
+
+    if (!test.response.body.empty()) {
+        result.push_back({.kind = SEARCH_BODY, .text = test.response.body});
     }
+
     return result;
 }
 
-bool AppState::filter(Test& test) noexcept {
-    return !str_contains(test.endpoint, this->tree_view.filter);
+void search_update(AppState* app) noexcept {
+    assert(app);
+
+    SearchState& search = app->search;
+    if (search.rebuild) {
+        search.rebuild = false;
+        search.changed.clear();
+        search.generation = app->undo_history.generation;
+        search.index.clear();
+        for (const auto& [id, nt] : app->tests) {
+            search.index.set(id, search_fields(nt));
+        }
+        return;
+    }
+
+    for (size_t id : search.changed) {
+        if (app->tests.contains(id)) {
+            search.index.set(id, search_fields(app->tests.at(id)));
+        } else {
+            search.index.erase(id);
+        }
+    }
+    search.changed.clear();
+
+    if (search.generation == app->undo_history.generation) {
+        return;
+    }
+    search.generation = app->undo_history.generation;
+
+    // Only ids are compared here, edited text is marked through changed
+    std::vector<size_t> removed;
+    for (const auto& [id, _] : search.index.documents) {
+        if (!app->tests.contains(id)) {
+            removed.push_back(id);
+        }
+    }
+    for (size_t id : removed) {
+        search.index.erase(id);
+    }
+    for (const auto& [id, nt] : app->tests) {
+        if (!search.index.contains(id)) {
+            search.index.set(id, search_fields(nt));
+        }
+    }
 }
 
-bool AppState::filter(NestedTest* nt) noexcept {
-    bool filter = std::visit([this](auto& elem) { return this->filter(elem); }, *nt);
+void search_matches_update(AppState* app) noexcept {
+    assert(app);
 
-    if (filter) {
-        this->tree_view.filtered_tests.insert(std::visit(IDVisitor(), *nt));
+    SearchState& search = app->search;
+    if (!search.matches_dirty && search.matches_generation == app->undo_history.generation) {
+        return;
+    }
+
+    search_update(app);
+    search.matches_dirty = false;
+    search.matches_generation = app->undo_history.generation;
+
+    if (search.query.empty()) {
+        search.matches.clear();
     } else {
-        this->tree_view.filtered_tests.erase(std::visit(IDVisitor(), *nt));
+        search.matches = search.index.search(search.query, search.kinds);
+    }
+}
+
+void AppState::tree_view_rows_update() noexcept {
+    if (!this->tree_view.rows_dirty &&
+        this->tree_view.rows_generation == this->undo_history.generation) {
+        return;
+    }
+
+    this->tree_view.rows_dirty = false;
+    this->tree_view.rows_generation = this->undo_history.generation;
+    this->tree_view.rows.clear();
+
+    // Depth first with children pushed in reverse so they pop in order
+    std::vector<TreeViewRow> stack = {{.id = 0, .idx = 0, .depth = 0}};
+    while (!stack.empty()) {
+        TreeViewRow row = stack.back();
+        stack.pop_back();
+
+        if (!this->tests.contains(row.id) || this->tree_view.filtered_tests.contains(row.id)) {
+            continue;
+        }
+        this->tree_view.rows.push_back(row);
+
+        const NestedTest& nt = this->tests.at(row.id);
+        if (!std::holds_alternative<Group>(nt)) {
+            continue;
+        }
+
+        const Group& group = std::get<Group>(nt);
+        if (!(group.flags & GROUP_OPEN)) {
+            continue;
+        }
+
+        for (size_t i = group.children_ids.size(); i-- > 0;) {
+            stack.push_back({.id = group.children_ids[i], .idx = i + 1, .depth = row.depth + 1});
+        }
     }
-    return filter;
 }
 
 bool AppState::save_file(std::ostream& out) noexcept {
@@ -774,10 +816,14 @@ bool AppState::save_file(std::ostream& out) noexcept {
         return false;
     }
 
+    // Stream straight into the output so the whole state is never buffered
     SaveState save{};
+    if (!save.begin_stream(&out)) {
+        Log(LogLevel::Error, "Failed to save");
+        return false;
+    }
     save.save(*this);
-    save.finish_save();
-    if (!save.write(out)) {
+    if (!save.finish_stream()) {
         Log(LogLevel::Error, "Failed to save");
         return false;
     }
@@ -793,7 +839,7 @@ bool AppState::open_file(std::istream& in) noexcept {
 
     SaveState save{};
     if (!save.read(in)) {
-        Log(LogLevel::Error, "Failed to read, likely file is invalid or size exceeds maximum");
+        Log(LogLevel::Error, "Failed to read, likely file is invalid");
         return false;
     }
 
@@ -818,6 +864,8 @@ void AppState::load_i18n() noexcept {
 AppState::AppState(HelloImGui::RunnerParams* _runner_params, bool _unit_testing) noexcept
     : runner_params(_runner_params), unit_testing(_unit_testing) {
     this->undo_history.reset_undo_history(this);
+    this->backup.local_generation.store(this->undo_history.generation);
+    this->backup.remote_generation.store(this->undo_history.generation);
 
     std::string conf_path =
         HelloImGui::IniFolderLocation(HelloImGui::IniFolderType::AppUserConfigFolder) + FS_SLASH
@@ -828,6 +876,8 @@ AppState::AppState(HelloImGui::RunnerParams* _runner_params, bool _unit_testing)
         std::filesystem::create_directory(conf_path);
     }
 
+    this->sync_cache.dir = conf_path + "sync_cache";
+
     std::string backup_path = this->conf.backup.get_default_local_dir();
 
     if (!std::filesystem::is_directory(backup_path)) {
@@ -853,10 +903,12 @@ bool status_match(const std::string& match, int status) noexcept {
     return true;
 }
 
-const char* body_match(const VariablesMap& vars, const Test* test,
+std::string body_match(AppState* app, const VariablesMap& vars, const Test* test,
                        const httplib::Result& result) noexcept {
+    assert(app);
+
     if (test->response.body_type == RESPONSE_ANY) {
-        return nullptr; // Skip checks
+        return ""; // Skip checks
     }
 
     if (result->has_header("Content-Type")) {
@@ -870,10 +922,17 @@ const char* body_match(const VariablesMap& vars, const Test* test,
 
         if (!test->response.body.empty()) {
             if (test->response.body_type == RESPONSE_JSON) {
-                const char* err =
-                    json_compare(replace_variables(vars, test->response.body), result->body);
+                // Expected body is parsed once for all of the results sharing it
+                std::shared_ptr<const nlohmann::json> expected =
+                    app->expected_json.get(replace_variables(vars, test->response.body));
+                if (!expected) {
+                    return "Invalid Expected JSON";
+                }
+
+                std::string path;
+                const char* err = json_compare(*expected, result->body, &path);
                 if (err) {
-                    return err;
+                    return path.empty() ? err : std::string(err) + " at " + path;
                 }
             } else {
                 if (replace_variables(vars, test->response.body) != result->body) {
@@ -883,37 +942,27 @@ const char* body_match(const VariablesMap& vars, const Test* test,
         }
     }
 
-    return nullptr;
+    return "";
 }
 
-// TODO: Add wildcards to header matching (easy)
-const char* header_match(const VariablesMap& vars, const Test* test,
+std::string header_match(AppState* app, const VariablesMap& vars, const Test* test,
                          const httplib::Result& result) noexcept {
-    httplib::Headers headers = response_headers(vars, test);
-    for (const auto& elem : test->response.cookies.elements) {
-        if (elem.flags & PARTIAL_DICT_ELEM_ENABLED) {
-            headers.emplace("Set-Cookie", elem.key + "=" + elem.data.data);
-        }
+    // Expected cookies are included as Set-Cookie headers
+    std::shared_ptr<const HeaderMatcher> matcher =
+        app->expected_headers.get(response_headers(vars, test));
+    if (!matcher->invalid.empty()) {
+        return "Invalid Expected Header '" + matcher->invalid + "'";
     }
 
-    for (const auto& [key, value] : headers) {
-        bool found = false;
-        for (const auto& [match_key, match_value] : result->headers) {
-            if (key == match_key && str_contains(match_value, value)) {
-                found = true;
-                break;
-            }
-        }
-
-        if (!found) {
-            return "Unexpected Response Headers";
-        }
+    const HeaderPattern* missing = matcher->match(result->headers);
+    if (missing) {
+        return "Unexpected Response Header '" + missing->name + "'";
     }
 
-    return nullptr;
+    return "";
 }
 
-bool test_analysis(AppState*, const Test* test, TestResult* test_result,
+bool test_analysis(AppState* app, const Test* test, TestResult* test_result,
                    httplib::Result&& http_result, const VariablesMap& vars) noexcept {
     bool success = true;
     switch (http_result.error()) {
@@ -921,50 +970,148 @@ bool test_analysis(AppState*, const Test* test, TestResult* test_result,
         if (!status_match(test->response.status, http_result->status)) {
             success = false;
 
-            test_result->status.store(STATUS_ERROR);
+            set_result_status(app, test_result, STATUS_ERROR);
             test_result->verdict = "Unexpected Response Status";
             break;
         }
 
-        char const* err = body_match(vars, test, http_result);
-        if (err) {
+        std::string body_err = body_match(app, vars, test, http_result);
+        if (!body_err.empty()) {
             success = false;
 
-            test_result->status.store(STATUS_ERROR);
-            test_result->verdict = err;
+            set_result_status(app, test_result, STATUS_ERROR);
+            test_result->verdict = std::move(body_err);
             break;
         }
 
-        err = header_match(vars, test, http_result);
-        if (err) {
+        std::string header_err = header_match(app, vars, test, http_result);
+        if (!header_err.empty()) {
             success = false;
 
-            test_result->status.store(STATUS_ERROR);
-            test_result->verdict = err;
+            set_result_status(app, test_result, STATUS_ERROR);
+            test_result->verdict = std::move(header_err);
             break;
         }
 
-        test_result->status.store(STATUS_OK);
+        set_result_status(app, test_result, STATUS_OK);
         test_result->verdict = "Success";
     } break;
     case httplib::Error::Canceled:
         success = false;
 
-        test_result->status.store(STATUS_CANCELLED);
+        set_result_status(app, test_result, STATUS_CANCELLED);
         break;
     default:
         success = false;
 
-        test_result->status.store(STATUS_ERROR);
+        set_result_status(app, test_result, STATUS_ERROR);
         test_result->verdict = to_string(http_result.error());
         break;
     }
 
     test_result->http_result = std::forward<httplib::Result>(http_result);
+    test_result->response_id.store(test_result->response_id.load() + 1);
+    results_tokenize(app, test_result);
 
     return success;
 }
 
+const FormattedBody* test_result_body(AppState* app, TestResult* result) noexcept {
+    assert(app);
+    assert(result);
+    assert(result->http_result.has_value() && result->http_result.value());
+
+    const httplib::Response* response = &*result->http_result.value();
+
+    std::shared_ptr<FormattedBody>& formatted = result->res_body_formatted;
+    size_t response_id = result->response_id.load();
+    if (!formatted || formatted->response_id != response_id) {
+        formatted = std::make_shared<FormattedBody>();
+        formatted->response_id = response_id;
+
+        app->format_thr_pool.detach_task([formatted, body = response->body]() mutable {
+            // Left as is when it isn't json, a single pass makes both the text and the tree
+            std::string text;
+            JsonTape tape;
+            if (tape.parse(body, &text)) {
+                body = std::move(text);
+                formatted->tape = std::move(tape);
+            }
+
+            if (body.size() > TEXT_SPILL_SIZE) {
+                formatted->mapped = MappedFile::spill(body);
+            }
+            if (formatted->mapped) {
+                body = {};
+            }
+            formatted->body = std::move(body);
+            formatted->lines = text_line_starts(formatted->text());
+
+            formatted->ready.store(true);
+        });
+    }
+
+    if (formatted->ready.load()) {
+        return formatted.get();
+    }
+    return nullptr;
+}
+
+const BodyDiff* test_result_diff(AppState* app, TestResult* result) noexcept {
+    assert(app);
+    assert(result);
+    assert(result->http_result.has_value() && result->http_result.value());
+
+    const httplib::Response* response = &*result->http_result.value();
+
+    std::shared_ptr<BodyDiff>& diff = result->res_body_diff;
+    size_t response_id = result->response_id.load();
+    if (!diff || diff->response_id != response_id) {
+        diff = std::make_shared<BodyDiff>();
+        diff->response_id = response_id;
+
+        const Response& expected_response = result->original_test.response;
+        bool is_json = expected_response.body_type == RESPONSE_JSON;
+        std::string expected = replace_variables(result->variables, expected_response.body);
+
+        app->format_thr_pool.detach_task([diff, is_json, expected = std::move(expected),
+                                          body = response->body]() mutable {
+            if (is_json) {
+                // Keys are sorted when dumped so their order doesn't show up as changes
+                nlohmann::json expected_json = nlohmann::json::parse(expected, nullptr, false);
+                nlohmann::json body_json = nlohmann::json::parse(body, nullptr, false);
+                if (!expected_json.is_discarded() && !body_json.is_discarded()) {
+                    expected = expected_json.dump(4);
+                    body = body_json.dump(4);
+                }
+            }
+
+            diff->expected = std::move(expected);
+            diff->response = std::move(body);
+            diff->expected_lines = text_line_starts(diff->expected);
+            diff->response_lines = text_line_starts(diff->response);
+
+            auto lines = [](std::string_view text, const std::vector<size_t>& starts) {
+                std::vector<std::string_view> result;
+                result.reserve(starts.size());
+                for (size_t i = 0; i < starts.size(); i++) {
+                    result.push_back(text_line(text, starts, i));
+                }
+                return result;
+            };
+            diff->rows = diff_collapse(diff_lines(lines(diff->expected, diff->expected_lines),
+                                                  lines(diff->response, diff->response_lines)));
+
+            diff->ready.store(true);
+        });
+    }
+
+    if (diff->ready.load()) {
+        return diff.get();
+    }
+    return nullptr;
+}
+
 httplib::Client make_client(const std::string& hostname, const ClientSettings& settings) noexcept {
     httplib::Client cli(hostname);
 
@@ -1030,11 +1177,19 @@ bool execute_test(AppState* app, const Test* test, size_t test_result_idx, httpl
     assert(app->test_results.at(test->id).size() > test_result_idx);
 
     test_result->running.store(true);
-    test_result->status.store(STATUS_RUNNING);
+    set_result_status(app, test_result, STATUS_RUNNING);
     test_result->req_body = body;
     test_result->req_content_type = content_type;
     test_result->req_endpoint = host + params_dest;
     test_result->req_headers = headers;
+    test_result->req_line =
+        std::string(HTTPTypeLabels[test->type]) + " " + params_dest + " HTTP/1.1";
+
+    // Replaced with what was actually sent, including headers added by the client
+    cli.set_logger([test_result](const httplib::Request& req, const httplib::Response&) {
+        test_result->req_line = req.method + " " + req.path + " HTTP/1.1";
+        test_result->req_headers = req.headers;
+    });
 
     auto progress = [app, test, test_result](size_t current, size_t total) -> bool {
         // Missing
@@ -1048,7 +1203,7 @@ bool execute_test(AppState* app, const Test* test, size_t test_result_idx, httpl
 
         // Stopped
         if (!test_result->running.load()) {
-            test_result->status.store(STATUS_CANCELLED);
+            set_result_status(app, test_result, STATUS_CANCELLED);
 
             return false;
         }
@@ -1079,30 +1234,7 @@ bool execute_test(AppState* app, const Test* test, size_t test_result_idx, httpl
         break;
     }
 
-    // Time to brute force library because request_headers_ is a private field!
-    for (const char* possible_header : RequestHeadersLabels) {
-        if (result.has_request_header(possible_header)) {
-            std::string header_value = result.get_request_header_value(possible_header);
-
-            auto [search_begin, search_end] = test_result->req_headers.equal_range(possible_header);
-            bool has_same_header_value = false;
-            for (auto it = search_begin; it != search_end; it++) {
-                if (it->second == header_value) {
-                    has_same_header_value = true;
-                    break;
-                }
-            }
-
-            if (!has_same_header_value) {
-                test_result->req_headers.emplace_hint(search_begin, possible_header, header_value);
-            }
-        }
-    }
-
-    if (result.error() == httplib::Error::Success) {
-        test_result->res_body = result->body;
-        const char* err = json_format(test_result->res_body);
-    }
+    cli.set_logger(nullptr);
 
     if (!app->test_results.contains(test->id)) {
         return false;
@@ -1288,6 +1420,9 @@ void run_dynamic_tests(AppState* app, const NestedTest& nt) noexcept {
     }
 
     app->test_results.merge(new_test_results);
+    for (size_t id : test_queue_ids) {
+        results_add(app, id);
+    }
 
     // Copies test queue and vars
     // Mutates cookies
@@ -1313,7 +1448,7 @@ void run_dynamic_tests(AppState* app, const NestedTest& nt) noexcept {
 
                     if (!keep_running) {
                         result->running.store(false);
-                        result->status.store(STATUS_CANCELLED);
+                        set_result_status(app, result, STATUS_CANCELLED);
                         result->verdict = "Previous test failed";
                         continue;
                     }
@@ -1367,6 +1502,7 @@ void run_test(AppState* app, size_t test_id) noexcept {
 
         assert(!app->test_results.contains(test_id));
         app->test_results.try_emplace(test_id, std::move(results));
+        results_add(app, test_id);
 
         for (size_t rerun = 0; rerun < cli_settings.test_reruns; rerun++) {
             // Copies test and ClientSettings
@@ -1387,6 +1523,7 @@ void run_test(AppState* app, size_t test_id) noexcept {
 void run_tests(AppState* app, const std::vector<size_t>& test_ids) noexcept {
     app->thr_pool.purge();
     app->test_results.clear();
+    results_clear(app);
 
     app->runner_params->dockingParams.dockableWindowOfName("Results###win_results")
         ->focusWindowAtNextFrame = true;
@@ -1408,7 +1545,9 @@ void rerun_test(AppState* app, TestResult* result) noexcept {
         return;
     }
 
-    result->status = STATUS_WAITING;
+    // Running until it's executed or stopped, same as new results
+    result->running.store(true);
+    set_result_status(app, result, STATUS_WAITING);
     result->verdict = "";
     result->progress_total = 0;
     result->progress_current = 0;
@@ -1432,19 +1571,218 @@ bool is_test_running(AppState* app, size_t id) noexcept {
         return false;
     }
 
-    for (auto& result : app->test_results.at(id)) {
-        if (result.running.load()) {
-            return true;
+    // Every result of a test shares its counters
+    const std::vector<TestResult>& results = app->test_results.at(id);
+    return !results.empty() && results.front().test_counters &&
+           results.front().test_counters->running();
+}
+
+bool results_filter(const ResultsState& results, TestResultStatus status) noexcept {
+    return status == results.filter || (status > results.filter && results.filter_cumulative);
+}
+
+TestResult* results_row(AppState* app, size_t row) noexcept {
+    assert(row < app->results.rows.size());
+    const ResultRow& result_row = app->results.rows.at(row);
+
+    assert(app->test_results.contains(result_row.id));
+    assert(app->test_results.at(result_row.id).size() > result_row.idx);
+    return &app->test_results.at(result_row.id).at(result_row.idx);
+}
+
+void results_add(AppState* app, size_t id) noexcept {
+    assert(app->test_results.contains(id));
+    ResultsState& results = app->results;
+    std::vector<TestResult>& test_results = app->test_results.at(id);
+
+    auto test_counters = std::make_shared<ResultCounters>();
+
+    results.first_row[id] = results.rows.size();
+    for (size_t idx = 0; idx < test_results.size(); idx++) {
+        size_t row = results.rows.size();
+        TestResult& result = test_results.at(idx);
+        TestResultStatus status = result.status.load();
+
+        result.test_counters = test_counters;
+        result.run_counters = app->run_counters;
+        test_counters->add(status);
+        app->run_counters->add(status);
+
+        results.rows.push_back({.id = id, .idx = idx});
+        results.row_status.push_back(status);
+
+        // New rows are last so visible stays in order, they have no tokens to match a query yet
+        if (results_filter(results, status) && results.visible_query.empty()) {
+            results.visible.push_back(row);
         }
     }
+}
 
-    return false;
+void results_clear(AppState* app) noexcept {
+    ResultsState& results = app->results;
+    results.rows.clear();
+    results.row_status.clear();
+    results.first_row.clear();
+    results.visible.clear();
+    results.details = std::nullopt;
+    results.last_selected_row = 0;
+    results.index.clear();
+    results.matches.clear();
+    results.index_changed = true;
+
+    // Results that are still running keep the old counters
+    app->run_counters = std::make_shared<ResultCounters>();
+
+    std::lock_guard<std::mutex> lock(app->result_events_mutex);
+    app->result_events.clear();
+    app->result_tokens.clear();
+}
+
+// Row of the result in the current run
+static std::optional<size_t> results_find(const ResultsState& results,
+                                          const ResultRow& result) noexcept {
+    auto it = results.first_row.find(result.id);
+    if (it == results.first_row.end()) {
+        return std::nullopt; // Results were cleared since
+    }
+
+    size_t row = it->second + result.idx;
+    if (row >= results.rows.size() || results.rows.at(row).id != result.id ||
+        results.rows.at(row).idx != result.idx) {
+        return std::nullopt;
+    }
+    return row;
+}
+
+void results_update(AppState* app) noexcept {
+    ResultsState& results = app->results;
+
+    std::vector<ResultRow> events;
+    std::vector<ResultTokens> tokens;
+    {
+        std::lock_guard<std::mutex> lock(app->result_events_mutex);
+        events.swap(app->result_events);
+        tokens.swap(app->result_tokens);
+    }
+
+    for (ResultTokens& result_tokens : tokens) {
+        std::optional<size_t> row = results_find(results, result_tokens.result);
+        if (result_tokens.run == app->run_counters && row.has_value()) {
+            results.index.set(row.value(), std::move(result_tokens.tokens));
+            results.index_changed = true;
+        }
+    }
+
+    bool rebuild = results.visible_filter != results.filter ||
+                   results.visible_cumulative != results.filter_cumulative;
+
+    // Matches are only looked up again when the index has something new
+    if (results.visible_query != results.query || results.index_changed) {
+        rebuild |= results.visible_query != results.query || !results.query.empty();
+        results.visible_query = results.query;
+        results.index_changed = false;
+        results.matches = results.index.search(results.query);
+    }
+
+    for (const ResultRow& event : events) {
+        std::optional<size_t> found = results_find(results, event);
+        if (!found.has_value()) {
+            continue;
+        }
+
+        size_t row = found.value();
+        TestResultStatus status = results_row(app, row)->status.load();
+        TestResultStatus old_status = std::exchange(results.row_status.at(row), status);
+
+        bool shown = results_filter(results, status);
+        if (rebuild || shown == results_filter(results, old_status)) {
+            continue;
+        }
+        if (!results.visible_query.empty() &&
+            !std::binary_search(results.matches.begin(), results.matches.end(), row)) {
+            continue;
+        }
+
+        // Rows that crossed the filter are moved in place so visible stays sorted
+        auto it = std::lower_bound(results.visible.begin(), results.visible.end(), row);
+        bool present = it != results.visible.end() && *it == row;
+        if (shown && !present) {
+            results.visible.insert(it, row);
+        } else if (!shown && present) {
+            results.visible.erase(it);
+        }
+    }
+
+    if (!rebuild) {
+        return;
+    }
+
+    results.visible_filter = results.filter;
+    results.visible_cumulative = results.filter_cumulative;
+
+    results.visible.clear();
+    if (results.visible_query.empty()) {
+        for (size_t row = 0; row < results.rows.size(); row++) {
+            if (results_filter(results, results.row_status.at(row))) {
+                results.visible.push_back(row);
+            }
+        }
+    } else {
+        for (size_t row : results.matches) {
+            if (results_filter(results, results.row_status.at(row))) {
+                results.visible.push_back(row);
+            }
+        }
+    }
 }
 
-void stop_test(TestResult* result) noexcept {
+void set_result_status(AppState* app, TestResult* result, TestResultStatus status) noexcept {
+    TestResultStatus old_status = result->status.value.exchange(status);
+    if (old_status != status) {
+        for (ResultCounters* counters : {result->test_counters.get(), result->run_counters.get()}) {
+            if (counters) {
+                counters->move(old_status, status);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(app->result_events_mutex);
+    app->result_events.push_back({.id = result->original_test.id, .idx = result->test_result_idx});
+}
+
+void results_tokenize(AppState* app, const TestResult* result) noexcept {
+    assert(app);
+    assert(result);
+
+    if (!result->http_result.has_value() || !result->http_result.value()) {
+        return;
+    }
+    const httplib::Response& response = *result->http_result.value();
+
+    // Fed a field at a time so nothing is copied, the text is dropped once it's split
+    SearchTokenizer tokenizer;
+    for (const auto& [key, value] : response.headers) {
+        tokenizer.feed(key);
+        tokenizer.feed(" ");
+        tokenizer.feed(value);
+        tokenizer.feed("\n");
+    }
+    tokenizer.feed(response.body);
+
+    ResultTokens result_tokens = {
+        .result = {.id = result->original_test.id, .idx = result->test_result_idx},
+        .run = result->run_counters,
+        .tokens = tokenizer.finish(),
+    };
+
+    std::lock_guard<std::mutex> lock(app->result_events_mutex);
+    app->result_tokens.push_back(std::move(result_tokens));
+}
+
+void stop_test(AppState* app, TestResult* result) noexcept {
     assert(result->running.load());
 
-    result->status.store(STATUS_CANCELLED);
+    set_result_status(app, result, STATUS_CANCELLED);
     result->running.store(false);
 }
 
@@ -1452,7 +1790,7 @@ void stop_test(AppState* app, size_t id) noexcept {
     assert(app->test_results.contains(id));
 
     for (auto& result : app->test_results.at(id)) {
-        stop_test(&result);
+        stop_test(app, &result);
     }
 }
 
@@ -1460,7 +1798,7 @@ void stop_tests(AppState* app) noexcept {
     for (auto& [id, results] : app->test_results) {
         for (auto& result : results) {
             if (result.running.load()) {
-                stop_test(&result);
+                stop_test(app, &result);
             }
         }
     }
@@ -1512,13 +1850,31 @@ void remote_file_open(AppState* app, const std::string& name) noexcept {
         {"session_token", app->conf.sync_session.data},
         {"file_name", name},
     };
-    auto proc = [app, name](Requestable<std::string>& requestable, const std::string& data) {
+
+    app->sync.file_open.status = REQUESTABLE_WAIT;
+    app->thr_pool.detach_task([app, name, params]() {
+        Requestable<std::string>& requestable = app->sync.file_open;
+
+        // Unchanged files are not downloaded again
+        std::optional<std::string> cached = app->sync_cache.get(name);
+
+        SyncClient cli(&app->sync_clients, app->conf.sync_hostname);
+
+        std::string error;
+        std::optional<std::string> data = sync_download(*cli, params, cached, &error);
+        if (!data.has_value()) {
+            requestable.error = error;
+            requestable.status = REQUESTABLE_ERROR;
+            return;
+        }
+
+        app->sync_cache.put(name, data.value());
         app->saved_file = RemoteFile{name};
 
-        requestable.data = data;
-    };
-    execute_requestable_async(app, app->sync.file_open, HTTP_GET, app->conf.sync_hostname, "/file",
-                              "", params, proc);
+        requestable.data = std::move(data.value());
+        requestable.error = "";
+        requestable.status = REQUESTABLE_FOUND;
+    });
 };
 
 void remote_file_delete(AppState* app, const std::string& name, bool sync) noexcept {
@@ -1527,8 +1883,9 @@ void remote_file_delete(AppState* app, const std::string& name, bool sync) noexc
         {"file_name", name},
     };
 
-    auto proc = [app, &name](Requestable<bool>& requestable, const std::string& data) {
+    auto proc = [app, name](Requestable<bool>& requestable, const std::string& data) {
         app->sync.files = {};
+        app->sync_cache.erase(name);
         // Commented out because of race conditions when files could be invalidated
         // app->sync.files.data.erase(
         //     std::remove(app->sync.files.data.begin(), app->sync.files.data.end(), name));
@@ -1555,6 +1912,7 @@ void remote_file_rename(AppState* app, const std::string& old_name,
 
     auto proc = [app, old_name, new_name](auto& requestable, const std::string& data) {
         app->sync.files = {};
+        app->sync_cache.rename(old_name, new_name);
 
         if (std::holds_alternative<RemoteFile>(app->saved_file) &&
             std::get<RemoteFile>(app->saved_file).filename == old_name) {
@@ -1573,35 +1931,56 @@ void remote_file_rename(AppState* app, const std::string& old_name,
 
 void remote_file_save(AppState* app, const std::string& name, bool sync,
                       Requestable<bool>* result) noexcept {
+    std::stringstream out;
+    app->save_file(out);
+
+    // Moved out so the file isn't copied again
+    remote_file_save_data(app, name, std::move(out).str(), sync, result);
+}
+
+void remote_file_save_data(AppState* app, const std::string& name, std::string body, bool sync,
+                           Requestable<bool>* result, const std::string& base_name) noexcept {
     if (result == nullptr) {
         result = &app->sync.file_save;
     }
 
-    std::stringstream out;
-    app->save_file(out);
-    std::string body = out.str();
+    if (!sync) {
+        result->status = REQUESTABLE_WAIT;
+        app->thr_pool.detach_task(
+            [app, name, body = std::move(body), result, base_name]() mutable {
+                remote_file_save_data(app, name, std::move(body), true, result, base_name);
+            });
+        return;
+    }
 
     httplib::Params params = {
         {"session_token", app->conf.sync_session.data},
         {"file_name", name},
     };
 
-    auto proc = [app, name](auto& requestable, const std::string& data) {
-        requestable.data = true;
+    result->status = REQUESTABLE_WAIT;
 
-        if (std::find(app->sync.files.data.begin(), app->sync.files.data.end(), name) ==
-            app->sync.files.data.end()) {
-            app->sync.files.data.push_back(name);
-        }
-    };
+    SyncClient cli(&app->sync_clients, app->conf.sync_hostname);
 
-    if (sync) {
-        execute_requestable_sync(app, *result, HTTP_POST, app->conf.sync_hostname, "/file", body,
-                                 params, proc);
-    } else {
-        execute_requestable_async(app, *result, HTTP_POST, app->conf.sync_hostname, "/file", body,
-                                  params, proc);
+    // Only a delta against the last acknowledged version is sent when possible
+    const std::string& base = base_name.empty() ? name : base_name;
+    std::string error = sync_upload(*cli, params, body, app->sync_cache.get(base), base_name);
+    if (!error.empty()) {
+        result->error = error;
+        result->status = REQUESTABLE_ERROR;
+        return;
+    }
+
+    app->sync_cache.put(name, body);
+
+    if (std::find(app->sync.files.data.begin(), app->sync.files.data.end(), name) ==
+        app->sync.files.data.end()) {
+        app->sync.files.data.push_back(name);
     }
+
+    result->data = true;
+    result->error = "";
+    result->status = REQUESTABLE_FOUND;
 };
 
 std::optional<BackupInfo> get_backup_info(const std::string& filename) noexcept {
@@ -1626,112 +2005,253 @@ std::optional<BackupInfo> get_backup_info(const std::string& filename) noexcept
     return result;
 }
 
-// TODO: backup only when file was changed
-void make_local_backup(AppState* app) noexcept {
+bool make_local_backup(AppState* app, const SaveState& snapshot, const std::string& name,
+                       const BackupConfig& conf) noexcept {
     namespace fs = std::filesystem;
 
-    std::string dir = app->conf.backup.get_local_dir();
+    std::string dir = conf.get_local_dir();
+    ChunkStore store{.dir = (fs::path(dir) / BACKUP_CHUNKS_DIR).string()};
 
-    std::string name = get_filename(get_saved_path(app->saved_file));
-    int64_t max_id = 0;
+    std::error_code ec;
+    fs::create_directories(dir, ec);
 
-    // Find a max ID of a backup
-    for (const auto& entry : fs::directory_iterator(dir)) {
+    // Existing backups are listed once for both finding the new id and removing old ones
+    std::vector<std::pair<int64_t, fs::path>> backups;
+    int64_t max_id = 0;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
         std::optional<BackupInfo> opt_info = get_backup_info(entry.path());
         if (!opt_info.has_value()) {
             continue;
         }
 
         BackupInfo info = opt_info.value();
-
-        if (info.name == name && info.id > max_id) {
-            max_id = info.id;
+        if (info.name != name) {
+            continue;
         }
+
+        backups.emplace_back(info.id, entry.path());
+        max_id = std::max<int64_t>(max_id, info.id);
     }
 
     max_id += 1;
 
-    std::string new_backup_path =
-        app->conf.backup.get_local_dir() + name + '_' + to_string(max_id) + ".wt";
+    std::string new_backup_path = dir + name + '_' + to_string(max_id) + ".wtm";
 
-    std::ofstream out(new_backup_path);
+    std::stringstream data;
     Log(LogLevel::Info, "Saving backup to local file '%s'", new_backup_path.c_str());
-    if (app->save_file(out)) {
-        Log(LogLevel::Info, "Successfully saved to '%s'!", new_backup_path.c_str());
+    if (!snapshot.write(data)) {
+        Log(LogLevel::Error, "Failed to save backup to '%s'", new_backup_path.c_str());
+        return false;
     }
 
-    // Remove entries with lower id
-    for (const auto& entry : fs::directory_iterator(dir)) {
-        std::optional<BackupInfo> opt_info = get_backup_info(entry.path());
-        if (!opt_info.has_value()) {
+    // Only chunks changed since the previous backups get written
+    std::optional<ChunkManifest> manifest = store.store(data.view());
+
+    // Written under a temporary name so older backups are only removed once it's complete
+    std::string tmp_path = new_backup_path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary);
+        bool written = manifest.has_value() && out && manifest->write(out);
+        out.close();
+        if (!written || !out) {
+            fs::remove(tmp_path, ec);
+            Log(LogLevel::Error, "Failed to save backup to '%s'", new_backup_path.c_str());
+            return false;
+        }
+    }
+
+    fs::rename(tmp_path, new_backup_path, ec);
+    if (ec) {
+        fs::remove(tmp_path, ec);
+        Log(LogLevel::Error, "Failed to save backup to '%s'", new_backup_path.c_str());
+        return false;
+    }
+    Log(LogLevel::Info, "Successfully saved to '%s'!", new_backup_path.c_str());
+    app->backup.progress_current++;
+
+    // Remove entries with lower id, including full copies made before chunking
+    for (const auto& [id, path] : backups) {
+        if (id <= max_id - conf.local_to_keep) {
+            fs::remove(path, ec);
+        }
+    }
+
+    // Chunks are shared between all files so every remaining manifest keeps its chunks alive
+    std::unordered_set<ChunkHash> live;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (entry.path().extension() != ".wtm") {
             continue;
         }
 
-        BackupInfo info = opt_info.value();
-        if (info.name == name && info.id <= max_id - app->conf.backup.local_to_keep) {
-            fs::remove(entry);
+        std::ifstream in(entry.path(), std::ios::binary);
+        ChunkManifest other{};
+        if (!other.read(in)) {
+            // Unreadable manifest might still refer to chunks, keep everything
+            Log(LogLevel::Warning, "Failed to read backup manifest '%s'",
+                entry.path().string().c_str());
+            live.clear();
+            break;
         }
+        live.insert(other.chunks.begin(), other.chunks.end());
+    }
+    if (!live.empty()) {
+        size_t removed = store.collect_garbage(live);
+        Log(LogLevel::Debug, "Removed %zu unused backup chunks", removed);
+    }
+    app->backup.progress_current++;
+
+    return true;
+}
+
+bool open_local_backup(AppState* app, const std::string& manifest_path) noexcept {
+    namespace fs = std::filesystem;
+
+    ChunkStore store{
+        .dir = (fs::path(manifest_path).parent_path() / BACKUP_CHUNKS_DIR).string(),
+    };
+
+    std::ifstream in(manifest_path, std::ios::binary);
+    ChunkManifest manifest{};
+    if (!in || !manifest.read(in)) {
+        Log(LogLevel::Error, "Failed to read backup '%s'", manifest_path.c_str());
+        return false;
+    }
+
+    std::optional<std::string> data = store.assemble(manifest);
+    if (!data.has_value()) {
+        Log(LogLevel::Error, "Backup '%s' is missing or has corrupted chunks",
+            manifest_path.c_str());
+        return false;
     }
+
+    std::stringstream ss(std::move(data.value()));
+    return app->open_file(ss);
 }
 
-void make_remote_backup(AppState* app) noexcept {
+bool make_remote_backup(AppState* app, const SaveState& snapshot, const std::string& name,
+                        const BackupConfig& conf) noexcept {
     Log(LogLevel::Info, "Making a remote backup...");
 
-    app->thr_pool.detach_task([app]() {
-        Requestable<std::vector<std::string>> file_list;
-        remote_file_list(app, true, &file_list);
+    Requestable<std::vector<std::string>> file_list;
+    remote_file_list(app, true, &file_list);
 
-        if (file_list.status != REQUESTABLE_FOUND) {
-            // TODO: Show these errors and a success message when finishing
-            // Log(LogLevel::Error, "Failed to fetch a list of remote files: %s",
-            //     file_list.error.c_str());
-            // Log(LogLevel::Error, "Failed to make a remote backup");
-            return;
-        }
+    if (file_list.status != REQUESTABLE_FOUND) {
+        Log(LogLevel::Error, "Failed to fetch a list of remote files: %s",
+            file_list.error.c_str());
+        return false;
+    }
 
-        std::string name = get_filename(get_saved_path(app->saved_file));
-        int64_t max_id = 0;
+    int64_t max_id = 0;
+    // Previous backup is the base of the new one so only what changed since is sent
+    std::string previous_filename = "";
 
-        // Find a max ID of a backup
-        for (const std::string& filename : file_list.data) {
-            std::optional<BackupInfo> opt_info = get_backup_info(filename);
+    // Find a max ID of a backup
+    for (const std::string& filename : file_list.data) {
+        std::optional<BackupInfo> opt_info = get_backup_info(filename);
 
-            if (!opt_info.has_value()) {
-                continue;
-            }
+        if (!opt_info.has_value()) {
+            continue;
+        }
 
-            BackupInfo info = opt_info.value();
-            if (info.name == name && info.id > max_id) {
-                max_id = info.id;
-            }
+        BackupInfo info = opt_info.value();
+        if (info.name == name && info.id > max_id) {
+            max_id = info.id;
+            previous_filename = filename;
         }
+    }
 
-        max_id += 1;
+    max_id += 1;
 
-        std::string new_backup_filename = name + '_' + to_string(max_id) + ".wt";
+    std::string new_backup_filename = name + '_' + to_string(max_id) + ".wt";
 
-        remote_file_save(app, new_backup_filename);
+    std::stringstream out;
+    snapshot.write(out);
 
-        // Remove entries with lower id
-        for (const std::string& filename : file_list.data) {
-            std::optional<BackupInfo> opt_info = get_backup_info(filename);
-            if (!opt_info.has_value()) {
-                continue;
-            }
+    Requestable<bool> saved;
+    remote_file_save_data(app, new_backup_filename, std::move(out).str(), true, &saved,
+                          previous_filename);
+    if (saved.status != REQUESTABLE_FOUND) {
+        Log(LogLevel::Error, "Failed to make a remote backup: %s", saved.error.c_str());
+        return false;
+    }
 
-            BackupInfo info = opt_info.value();
-            if (info.name == name && info.id <= max_id - app->conf.backup.remote_to_keep) {
-                remote_file_delete(app, filename);
-            }
+    // Only the newest backup is needed as a base, older copies aren't kept around
+    if (!previous_filename.empty()) {
+        app->sync_cache.erase(previous_filename);
+    }
+    app->backup.progress_current++;
+
+    // Remove entries with lower id
+    std::vector<std::string> to_delete;
+    for (const std::string& filename : file_list.data) {
+        std::optional<BackupInfo> opt_info = get_backup_info(filename);
+        if (!opt_info.has_value()) {
+            continue;
         }
-    });
+
+        BackupInfo info = opt_info.value();
+        if (info.name == name && info.id <= max_id - conf.remote_to_keep) {
+            to_delete.push_back(filename);
+        }
+    }
+
+    if (!to_delete.empty()) {
+        httplib::Params params = {
+            {"session_token", app->conf.sync_session.data},
+        };
+
+        SyncClient cli(&app->sync_clients, app->conf.sync_hostname);
+        std::string error = sync_delete(*cli, params, to_delete);
+        if (!error.empty()) {
+            Log(LogLevel::Error, "Failed to remove old remote backups: %s", error.c_str());
+        }
+
+        for (const std::string& filename : to_delete) {
+            app->sync_cache.erase(filename);
+        }
+        app->sync.files = {};
+    }
+    app->backup.progress_current++;
+
+    return true;
 }
 
 void make_backups(AppState* app) noexcept {
-    if (app->conf.backup.local_to_keep > 0) {
-        make_local_backup(app);
+    BackupConfig conf = app->conf.backup;
+    if (conf.local_to_keep <= 0 && conf.remote_to_keep <= 0) {
+        return;
+    }
+
+    if (app->backup.running.load()) {
+        // Previous backup is still in progress, try again next time
+        return;
     }
-    if (app->conf.backup.remote_to_keep > 0) {
-        make_remote_backup(app);
+
+    // Each side is retried on its own until it succeeds, a working one isn't repeated
+    size_t generation = app->undo_history.generation;
+    bool local = conf.local_to_keep > 0 && app->backup.local_generation.load() != generation;
+    bool remote = conf.remote_to_keep > 0 && app->backup.remote_generation.load() != generation;
+    if (!local && !remote) {
+        Log(LogLevel::Debug, "Nothing changed since the last backup, skipping");
+        return;
     }
+
+    // Undo states are never modified so the current one can be written while editing continues
+    std::shared_ptr<const SaveState> snapshot = app->undo_history.current();
+    std::string name = get_filename(get_saved_path(app->saved_file));
+
+    app->backup.running.store(true);
+    app->backup.progress_current.store(0);
+    app->backup.progress_total.store((local ? 2 : 0) + (remote ? 2 : 0));
+
+    app->backup_thr_pool.detach_task([app, snapshot, name, conf, generation, local, remote]() {
+        if (local && make_local_backup(app, *snapshot, name, conf)) {
+            app->backup.local_generation.store(generation);
+        }
+        if (remote && make_remote_backup(app, *snapshot, name, conf)) {
+            app->backup.remote_generation.store(generation);
+        }
+
+        app->backup.running.store(false);
+    });
 }
@@ -11,13 +11,19 @@
 
 #include "partial_dict.hpp"
 #include "save_state.hpp"
+#include "search.hpp"
+#include "sync.hpp"
 #include "tests.hpp"
 
+#include "atomic"
 #include "cmath"
+#include "memory"
+#include "mutex"
 #include "optional"
 #include "string"
 #include "unordered_map"
 #include "variant"
+#include "vector"
 
 // TODO: Add unit tests to app_state
 
@@ -43,6 +49,11 @@ template <class Data> struct Requestable {
     RequestableStatus status = REQUESTABLE_NONE;
     std::string error = "";
     Data data = {};
+
+    // Error is only relevant to the last request so it isn't saved
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&Requestable::status, &Requestable::data);
+    }
 };
 
 struct BackupConfig {
@@ -55,9 +66,10 @@ struct BackupConfig {
     std::string get_default_local_dir() const noexcept;
     std::string get_local_dir() const noexcept;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&BackupConfig::time_to_backup, &BackupConfig::local_to_keep,
+                               &BackupConfig::remote_to_keep, &BackupConfig::local_dir);
+    }
 };
 
 struct UserConfig {
@@ -66,15 +78,18 @@ struct UserConfig {
     std::string sync_hostname = "https://weetee-sync.vercel.app";
     Requestable<std::string> sync_session = {};
     std::string sync_name = "";
-    std::string sync_password = "";
+    std::string sync_password = ""; // Saved clientside for future encryption
+                                     // Worry about it being in plain text?
 
     BackupConfig backup = {};
 
     static constexpr const char* filename = FS_SLASH "weetee" FS_SLASH "user_config.wt";
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&UserConfig::sync_hostname, &UserConfig::sync_session,
+                               &UserConfig::sync_name, &UserConfig::sync_password,
+                               &UserConfig::language, save_field_since<2>(&UserConfig::backup));
+    }
 
     void open_file() noexcept;
     void save_file() noexcept;
@@ -94,6 +109,13 @@ struct SyncState {
     std::string filename = "";
 };
 
+// Visible row of the tree view, idx is the position in the parent used for drag and drop
+struct TreeViewRow {
+    size_t id;
+    size_t idx;
+    size_t depth;
+};
+
 struct TreeViewState {
     size_t last_selected_idx = 0;
 
@@ -101,6 +123,12 @@ struct TreeViewState {
     std::unordered_set<size_t> filtered_tests = {};
     std::unordered_set<size_t> selected_tests = {};
 
+    // Open and not filtered tests flattened in drawing order
+    std::vector<TreeViewRow> rows = {};
+    // Set when groups are opened or closed, edits are tracked by the undo generation
+    bool rows_dirty = true;
+    size_t rows_generation = 0;
+
     // Updated every frame, needed for shortcuts to work
     bool window_focused;
 };
@@ -110,11 +138,72 @@ struct EditorState {
     std::unordered_map<size_t, EditorTab> open_tabs = {};
 };
 
+// Position of a result in AppState::test_results
+struct ResultRow {
+    size_t id;
+    size_t idx;
+};
+
+// Words of a response, found by the thread that received it
+struct ResultTokens {
+    ResultRow result;
+    // Run the result belongs to, tokens of results that were cleared are dropped
+    std::shared_ptr<ResultCounters> run;
+    std::vector<std::string> tokens;
+};
+
 struct ResultsState {
-    size_t last_selected_id = 0;
-    size_t last_selected_idx = 0;
+    size_t last_selected_row = 0;
     TestResultStatus filter = STATUS_OK;
     bool filter_cumulative = true;
+
+    // Every result in the order they were added, indexed by row
+    std::vector<ResultRow> rows = {};
+    // Status of every row when it was last filtered
+    std::vector<TestResultStatus> row_status = {};
+    // Row of the first result of every test, the rest follow it
+    std::unordered_map<size_t, size_t> first_row = {};
+
+    // Rows passing the filter in order
+    std::vector<size_t> visible = {};
+    TestResultStatus visible_filter = STATUS_OK;
+    bool visible_cumulative = true;
+
+    // Response headers and bodies of the run, indexed by row as they arrive
+    SearchTokenIndex index = {};
+    bool index_changed = false;
+    // Only rows matching it are visible when it isn't empty
+    std::string query = "";
+    std::string visible_query = "";
+    // Sorted rows matching visible_query
+    std::vector<size_t> matches = {};
+
+    // Row shown in the details modal
+    std::optional<size_t> details = std::nullopt;
+    TextViewState details_body = {};
+    JsonTreeState details_tree = {};
+    DiffViewState details_diff = {};
+    bool details_as_tree = true;
+
+    // Selection state computed when the context menu opens
+    bool any_running = false;
+    bool any_not_running = false;
+};
+
+struct SearchState {
+    SearchIndex index = {};
+    // Tests whose text was edited since the index was updated, added and deleted tests are
+    // found by comparing ids when the undo generation changes
+    std::unordered_set<size_t> changed = {};
+    bool rebuild = true;
+    size_t generation = 0;
+
+    // Search panel
+    std::string query = "";
+    uint8_t kinds = SEARCH_KIND_ALL;
+    std::vector<SearchMatch> matches = {};
+    bool matches_dirty = true;
+    size_t matches_generation = 0;
 };
 
 struct RemoteFile {
@@ -136,6 +225,16 @@ std::string get_saved_path(const SavedFile& saved);
 
 struct BackupState {
     float time_since_last_backup = 0;
+
+    // Undo history generation that was last backed up to each side, unchanged state isn't
+    // backed up again, written by the backup thread once a backup succeeds
+    std::atomic<size_t> local_generation = 0;
+    std::atomic<size_t> remote_generation = 0;
+
+    // Written by the backup thread
+    std::atomic<bool> running = false;
+    std::atomic<size_t> progress_current = 0;
+    std::atomic<size_t> progress_total = 0;
 };
 
 struct SettingsState {
@@ -144,6 +243,25 @@ struct SettingsState {
     std::string search = "";
 };
 
+// References resolved during a single swagger import, safe to share between threads
+struct SwaggerRefCache {
+    const nlohmann::json* swagger;
+
+    std::mutex mutex;
+    // External documents by location, nullptr when failed to load
+    std::unordered_map<std::string, std::shared_ptr<const nlohmann::json>> documents;
+    // Targets of references pointing into swagger or documents, nullptr when not found
+    std::unordered_map<std::string, const nlohmann::json*> targets;
+    // Examples generated for referenced schemas
+    std::unordered_map<std::string, nlohmann::json> examples;
+};
+
+// Swagger path converted off the main thread, ids are assigned when it's merged
+struct SwaggerPathImport {
+    Group group;
+    std::vector<Test> tests;
+};
+
 struct AppState {
     size_t id_counter = 0;
 
@@ -157,6 +275,7 @@ struct AppState {
     TreeViewState tree_view = {};
     EditorState editor = {};
     ResultsState results = {};
+    SearchState search = {};
     SyncState sync = {};
     SettingsState settings = {};
     BackupState backup = {};
@@ -166,7 +285,28 @@ struct AppState {
 
     SavedFile saved_file;
 
+    // Expected response bodies, shared between tests running at the same time
+    JsonCache expected_json;
+    // Expected response headers, compiled once for every result expecting the same ones
+    HeaderMatcherCache expected_headers;
+
+    // Counters of the current run, replaced when results are cleared
+    std::shared_ptr<ResultCounters> run_counters = std::make_shared<ResultCounters>();
+
+    // Results whose status changed, written from any thread and applied in results_update
+    std::mutex result_events_mutex;
+    std::vector<ResultRow> result_events;
+    std::vector<ResultTokens> result_tokens;
+
+    // Outside of SyncState since it's reset on logout
+    SyncCache sync_cache;
+    SyncClientPool sync_clients;
+
     BS::thread_pool thr_pool;
+    // Single thread so backups never overlap, declared after the state it uses
+    BS::thread_pool backup_thr_pool{1};
+    // Separate so formatting isn't purged or queued behind running tests
+    BS::thread_pool format_thr_pool{1};
 
     ImFont* regular_font;
     ImFont* mono_font;
@@ -181,10 +321,12 @@ struct AppState {
     const Group* root_group() const noexcept;
 
     bool is_running_tests() const noexcept;
+    // True while background work can change what's drawn
+    bool is_busy() noexcept;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&AppState::id_counter, &AppState::tests);
+    }
 
     void editor_open_tab(size_t id) noexcept;
 
@@ -259,21 +401,23 @@ struct AppState {
     void move(Group* group, size_t idx) noexcept;
     void sort(Group& group) noexcept;
 
-    // Returns true when the value should be filtered *OUT*
-    bool filter(Group& group) noexcept;
-    bool filter(Test& test) noexcept;
-    bool filter(NestedTest* nt) noexcept;
+    // Filters out tests that don't match tree_view.filter and their groups when none of
+    // their children match
+    void filter() noexcept;
+
+    // Rebuilds tree_view.rows when the tree, the filter or open groups changed
+    void tree_view_rows_update() noexcept;
 
     bool save_file(std::ostream&) noexcept;
     bool open_file(std::istream&) noexcept;
     void post_open() noexcept;
 
-    void import_swagger_paths(const nlohmann::json& paths, const nlohmann::json& swagger) noexcept;
+    void import_swagger_merge(std::vector<SwaggerPathImport>&& imported) noexcept;
     void import_swagger_servers(const nlohmann::json&) noexcept;
     void import_swagger(const std::string& filename) noexcept;
 
-    void export_swagger_paths(nlohmann::json&) const noexcept;
-    void export_swagger_servers(nlohmann::json&) const noexcept;
+    void export_swagger_paths(JsonWriter&) const;
+    void export_swagger_servers(JsonWriter&) const;
     void export_swagger(const std::string& filename) const noexcept;
 
     void load_i18n() noexcept;
@@ -338,17 +482,40 @@ void rerun_test(AppState* app, TestResult* result) noexcept;
 
 bool is_test_running(AppState* app, size_t id) noexcept;
 
-void stop_test(TestResult* result) noexcept;
+// Returns true when status passes the results filter
+bool results_filter(const ResultsState& results, TestResultStatus status) noexcept;
+TestResult* results_row(AppState* app, size_t row) noexcept;
+void results_add(AppState* app, size_t id) noexcept;
+void results_clear(AppState* app) noexcept;
+// Applies status changes and filter changes to the visible rows, main thread only
+void results_update(AppState* app) noexcept;
+// Sets status and lets results_update know about it, safe from any thread
+void set_result_status(AppState* app, TestResult* result, TestResultStatus status) noexcept;
+// Indexes the response once it's received, safe from any thread
+void results_tokenize(AppState* app, const TestResult* result) noexcept;
+
+// Brings the search index up to date with the tests
+void search_update(AppState* app) noexcept;
+// Runs the search panel query again when the query or the tests changed
+void search_matches_update(AppState* app) noexcept;
+
+void stop_test(AppState* app, TestResult* result) noexcept;
 void stop_test(AppState* app, size_t id) noexcept;
 void stop_tests(AppState* app) noexcept;
 
 bool status_match(const std::string& match, int status) noexcept;
-const char* body_match(const VariablesMap& vars, const Test* test,
+// Returns an error, empty when matched
+std::string body_match(AppState* app, const VariablesMap& vars, const Test* test,
                        const httplib::Result& result) noexcept;
-const char* header_match(const VariablesMap&, const Test* test,
+// Returns an error, empty when matched
+std::string header_match(AppState* app, const VariablesMap& vars, const Test* test,
                          const httplib::Result& result) noexcept;
 bool test_analysis(AppState*, const Test* test, TestResult* test_result,
                    httplib::Result&& http_result, const VariablesMap& vars) noexcept;
+// Returns pretty printed response body with its lines once it's ready, nullptr until then
+const FormattedBody* test_result_body(AppState* app, TestResult* result) noexcept;
+// Returns expected body compared to the response once it's ready, nullptr until then
+const BodyDiff* test_result_diff(AppState* app, TestResult* result) noexcept;
 
 template <class Data, class Process>
 void execute_requestable_sync(AppState* app, Requestable<Data>& requestable, HTTPType type,
@@ -357,24 +524,23 @@ void execute_requestable_sync(AppState* app, Requestable<Data>& requestable, HTT
                               Process&& process) noexcept {
     requestable.status = REQUESTABLE_WAIT;
 
-    httplib::Client cli(hostname);
-
-    cli.set_follow_location(true);
+    // Connection is reused between requests to the same host
+    SyncClient cli(&app->sync_clients, hostname);
 
     httplib::Result result;
     std::string dest_params = httplib::append_query_params(destination, params);
     switch (type) {
     case HTTP_GET:
-        result = cli.Get(dest_params);
+        result = cli->Get(dest_params);
         break;
     case HTTP_POST:
-        result = cli.Post(dest_params, body, "application/octet-stream");
+        result = cli->Post(dest_params, body, "application/octet-stream");
         break;
     case HTTP_DELETE:
-        result = cli.Delete(dest_params, body, "application/octet-stream");
+        result = cli->Delete(dest_params, body, "application/octet-stream");
         break;
     case HTTP_PATCH:
-        result = cli.Patch(dest_params, body, "application/octet-stream");
+        result = cli->Patch(dest_params, body, "application/octet-stream");
         break;
     default:
         break;
@@ -416,9 +582,15 @@ void remote_file_open(AppState* app, const std::string&) noexcept;
 void remote_file_delete(AppState* app, const std::string&, bool sync = false) noexcept;
 void remote_file_rename(AppState* app, const std::string&, const std::string&) noexcept;
 void remote_file_save(AppState* app, const std::string&, bool sync = false, Requestable<bool>* result = nullptr) noexcept;
+// Uploads already serialized data, can be called from any thread
+// Large files are uploaded in resumable pieces, base_name is sent as the base of a new file
+void remote_file_save_data(AppState* app, const std::string& name, std::string data, bool sync = false, Requestable<bool>* result = nullptr, const std::string& base_name = "") noexcept;
 
 // Backup naming scheme
-// name_id.wt
+// name_id.wt for remote backups
+// name_id.wtm for local backups, a manifest of chunks stored in BACKUP_CHUNKS_DIR next to it
+constexpr const char* BACKUP_CHUNKS_DIR = "chunks";
+
 struct BackupInfo {
     std::string name;
     uint32_t id;
@@ -426,6 +598,13 @@ struct BackupInfo {
 
 std::optional<BackupInfo> get_backup_info(const std::string& filename) noexcept;
 
-void make_local_backup(AppState* app) noexcept;
-void make_remote_backup(AppState* app) noexcept;
+// Both are called on the backup thread with a snapshot taken by make_backups
+// Return false when the backup wasn't made, failing to remove old ones doesn't count
+bool make_local_backup(AppState* app, const SaveState& snapshot, const std::string& name,
+                       const BackupConfig& conf) noexcept;
+bool make_remote_backup(AppState* app, const SaveState& snapshot, const std::string& name,
+                        const BackupConfig& conf) noexcept;
+// Reassembles a local backup manifest and opens it
+bool open_local_backup(AppState* app, const std::string& manifest_path) noexcept;
+// Backs up the current undo state in the background, skipped when nothing changed
 void make_backups(AppState* app) noexcept;
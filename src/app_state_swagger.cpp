@@ -1,4 +1,10 @@
+#include "algorithm"
+#include "deque"
 #include "fstream"
+#include "functional"
+#include "future"
+#include "map"
+#include "unordered_set"
 
 #include "json.hpp"
 #include "app_state.hpp"
@@ -49,40 +55,16 @@ void AppState::import_swagger_servers(const nljson& servers) noexcept {
     // NOTE: Missing description
 }
 
-nljson resolve_swagger_ref(const nljson& relative, const nljson& swagger) noexcept {
-    if (!relative.contains("$ref")) {
-        return relative;
-    }
-
-    std::string ref = relative.at("$ref");
-    std::string location, local;
-    nljson resolved;
-
-    {
-        size_t separator = ref.find("#/");
-        if (separator != std::string::npos) {
-            location = ref.substr(0, separator);
-            local = ref.substr(separator + 2);
-            resolved = swagger;
-        }
-    }
-
-    {
-        size_t separator = ref.find("~/");
-        if (separator != std::string::npos) {
-            location = ref.substr(0, separator);
-            local = ref.substr(separator + 2);
-            resolved = relative;
-        }
-    }
-
-    resolved.erase("$ref");
-
-    if (location.empty() && local.empty()) {
-        Log(LogLevel::Error, "Failed to resolve swagger Reference '%s'", ref.c_str());
-        return {};
+// Splits a reference into a location of an external document and a JSON pointer
+static std::pair<std::string, std::string> split_swagger_ref(const std::string& ref) noexcept {
+    size_t separator = ref.find("#/");
+    if (separator == std::string::npos) {
+        return {ref, ""};
     }
+    return {ref.substr(0, separator), ref.substr(separator + 2)};
+}
 
+static std::shared_ptr<const nljson> load_swagger_document(const std::string& location) noexcept {
     if (location.find("//") != std::string::npos) {
         // URL Reference
         auto [host, endpoint] = split_endpoint(location);
@@ -92,107 +74,252 @@ nljson resolve_swagger_ref(const nljson& relative, const nljson& swagger) noexce
         if (result.error() != httplib::Error::Success) {
             Log(LogLevel::Error, "Failed to resolve swagger URL Reference '%s' : %s",
                 location.c_str(), to_string(result.error()).c_str());
-            return {};
-        } else {
-            nljson json = nljson::parse(result->body, nullptr, false);
-            if (json.is_discarded()) {
-                Log(LogLevel::Error, "Failed to parse swagger URL Reference '%s'",
-                    location.c_str());
-                return {};
-            }
+            return nullptr;
+        }
 
-            resolved = json;
+        nljson json = nljson::parse(result->body, nullptr, false);
+        if (json.is_discarded()) {
+            Log(LogLevel::Error, "Failed to parse swagger URL Reference '%s'", location.c_str());
+            return nullptr;
         }
+
+        return std::make_shared<const nljson>(std::move(json));
+    }
+
+    // File
+    std::ifstream in(location);
+    if (!in) {
+        Log(LogLevel::Error, "Failed to open swagger Remote Reference '%s'", location.c_str());
+        return nullptr;
     }
 
-    if (!location.empty()) {
-        // File
+    nljson json = nljson::parse(in, nullptr, false);
+    if (json.is_discarded()) {
+        Log(LogLevel::Error, "Failed to parse swagger Remote Reference '%s'", location.c_str());
+        return nullptr;
+    }
 
-        std::ifstream in(location);
-        if (!in) {
-            Log(LogLevel::Error, "Failed to open swagger Remote Reference '%s'", location.c_str());
-            return {};
+    return std::make_shared<const nljson>(std::move(json));
+}
+
+static const nljson* swagger_document(const std::string& location,
+                                      SwaggerRefCache& refs) noexcept {
+    if (location.empty()) {
+        return refs.swagger;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(refs.mutex);
+        auto it = refs.documents.find(location);
+        if (it != refs.documents.end()) {
+            return it->second.get();
         }
+    }
 
-        nljson json = nljson::parse(in, nullptr, false);
-        if (json.is_discarded()) {
-            Log(LogLevel::Error, "Failed to parse swagger Remote Reference '%s'", location.c_str());
-            return {};
+    // Loaded without holding the lock, the first one to finish is kept
+    std::shared_ptr<const nljson> document = load_swagger_document(location);
+
+    std::lock_guard<std::mutex> lock(refs.mutex);
+    return refs.documents.try_emplace(location, std::move(document)).first->second.get();
+}
+
+static void prefetch_swagger_documents(BS::thread_pool& pool, SwaggerRefCache& refs,
+                                       const std::unordered_set<std::string>& locations) noexcept {
+    // Every document is loaded once and all of them at the same time
+    std::vector<std::future<std::shared_ptr<const nljson>>> futures;
+    futures.reserve(locations.size());
+    for (const std::string& location : locations) {
+        futures.push_back(
+            pool.submit_task([location]() { return load_swagger_document(location); }));
+    }
+
+    auto location = locations.begin();
+    for (auto& future : futures) {
+        refs.documents.try_emplace(*location, future.get());
+        location++;
+    }
+}
+
+static const nljson* resolve_swagger_pointer(const std::string& ref,
+                                             SwaggerRefCache& refs) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(refs.mutex);
+        auto it = refs.targets.find(ref);
+        if (it != refs.targets.end()) {
+            return it->second;
         }
+    }
 
-        resolved = json;
+    auto [location, local] = split_swagger_ref(ref);
+    const nljson* resolved = swagger_document(location, refs);
+
+    // Reference without a pointer is the whole document
+    std::vector<std::string> names;
+    if (!local.empty()) {
+        names = split_string(local, "/");
     }
 
-    std::vector<std::string> locals = split_string(local, "/");
+    for (std::string& name : names) {
+        if (resolved == nullptr) {
+            break;
+        }
 
-    for (std::string& name : locals) {
-        find_and_replace(name, "~0", "~");
         find_and_replace(name, "~1", "/");
+        find_and_replace(name, "~0", "~");
 
-        if (resolved.contains(name)) {
-            resolved = resolved.at(name);
+        if (resolved->is_object() && resolved->contains(name)) {
+            resolved = &resolved->at(name);
         } else {
             Log(LogLevel::Error, "Failed to find swagger Reference '%s' for '%s'", name.c_str(),
                 local.c_str());
+            resolved = nullptr;
+        }
+    }
+
+    // Documents are never modified so pointers into them stay valid
+    std::lock_guard<std::mutex> lock(refs.mutex);
+    refs.targets.emplace(ref, resolved);
+    return resolved;
+}
+
+nljson resolve_swagger_ref(const nljson& relative, SwaggerRefCache& refs) noexcept {
+    if (!relative.is_object() || !relative.contains("$ref")) {
+        return relative;
+    }
+
+    std::string ref = relative.at("$ref");
+    nljson resolved;
+
+    size_t relative_separator = ref.find("~/");
+    if (relative_separator != std::string::npos) {
+        // Relative to the object itself, different for every object so not cached
+        resolved = relative;
+        resolved.erase("$ref");
+
+        std::string local = ref.substr(relative_separator + 2);
+        for (std::string& name : split_string(local, "/")) {
+            find_and_replace(name, "~1", "/");
+            find_and_replace(name, "~0", "~");
+
+            if (!resolved.contains(name)) {
+                Log(LogLevel::Error, "Failed to find swagger Reference '%s' for '%s'",
+                    name.c_str(), local.c_str());
+                return {};
+            }
+            nljson child = std::move(resolved.at(name));
+            resolved = std::move(child);
+        }
+    } else {
+        const nljson* target = resolve_swagger_pointer(ref, refs);
+        if (target == nullptr) {
+            Log(LogLevel::Error, "Failed to resolve swagger Reference '%s'", ref.c_str());
             return {};
         }
+        resolved = *target;
     }
 
-    if (resolved.is_object() && relative.is_object()) {
+    if (resolved.is_object()) {
         resolved.merge_patch(relative);
     }
 
     return resolved;
 }
 
-nljson import_schema_example(const nljson& schema, const nljson& swagger) noexcept {
-    nljson schema_value = resolve_swagger_ref(schema, swagger);
+// cuts counts the recursive references replaced by an empty object so far
+static nljson import_schema_example(const nljson& schema, SwaggerRefCache& refs,
+                                    std::unordered_set<std::string>& visiting,
+                                    size_t* cuts) noexcept;
 
-    if (schema_value.contains("example")) {
-        return schema_value.at("example");
+nljson import_schema_example(const nljson& schema, SwaggerRefCache& refs) noexcept {
+    std::unordered_set<std::string> visiting;
+    size_t cuts = 0;
+    return import_schema_example(schema, refs, visiting, &cuts);
+}
+
+static nljson import_schema_example(const nljson& schema, SwaggerRefCache& refs,
+                                    std::unordered_set<std::string>& visiting,
+                                    size_t* cuts) noexcept {
+    assert(cuts);
+
+    // Shared schemas only differ by their reference so their examples are reused
+    std::optional<std::string> ref;
+    if (schema.is_object() && schema.size() == 1 && schema.contains("$ref") &&
+        schema.at("$ref").is_string()) {
+        ref = schema.at("$ref").get<std::string>();
+
+        {
+            std::lock_guard<std::mutex> lock(refs.mutex);
+            auto it = refs.examples.find(ref.value());
+            if (it != refs.examples.end()) {
+                return it->second;
+            }
+        }
+
+        if (visiting.contains(ref.value())) {
+            // Recursive schema
+            (*cuts)++;
+            return nljson::object();
+        }
+        visiting.insert(ref.value());
     }
+    size_t cuts_before = *cuts;
 
-    if (schema_value.contains("type")) {
+    nljson result;
+    nljson schema_value = resolve_swagger_ref(schema, refs);
+
+    if (schema_value.contains("example")) {
+        result = schema_value.at("example");
+    } else if (schema_value.contains("type")) {
         if (schema_value.at("type") == "object") {
             std::unordered_map<std::string, nljson> object_example;
 
             if (schema_value.contains("properties")) {
                 for (auto& [key, value] : schema_value.at("properties").items()) {
-                    object_example.emplace(key, import_schema_example(value, swagger));
+                    object_example.emplace(key, import_schema_example(value, refs, visiting, cuts));
                 }
             }
 
-            return object_example;
-        }
-
-        if (schema_value.at("type") == "array") {
+            result = object_example;
+        } else if (schema_value.at("type") == "array") {
             std::vector<nljson> array_example;
 
             if (schema_value.contains("items")) {
                 array_example.emplace_back(
-                    import_schema_example(schema_value.at("items"), swagger));
+                    import_schema_example(schema_value.at("items"), refs, visiting, cuts));
             }
 
-            return array_example;
+            result = array_example;
+        } else {
+            // Encode weetee variable as a json object with specific key
+            std::string example_var = schema_value.at("type");
+            nljson object_var = nljson::object();
+            object_var.emplace(WEETEE_VARIABLE_KEY, example_var);
+            result = object_var;
         }
+    } else {
+        result = schema_value;
+    }
+
+    if (ref.has_value()) {
+        visiting.erase(ref.value());
 
-        // Encode weetee variable as a json object with specific key
-        std::string example_var = schema_value.at("type");
-        nljson object_var = nljson::object();
-        object_var.emplace(WEETEE_VARIABLE_KEY, example_var);
-        return object_var;
+        // Cut examples depend on where the cycle was entered so they're made again every time
+        if (*cuts == cuts_before) {
+            std::lock_guard<std::mutex> lock(refs.mutex);
+            refs.examples.emplace(ref.value(), result);
+        }
     }
 
-    return schema_value;
+    return result;
 }
 
 std::pair<Variables, Parameters> import_swagger_parameters(const nljson& parameters,
-                                                           const nljson& swagger) noexcept {
+                                                           SwaggerRefCache& refs) noexcept {
     Variables vars;
     Parameters params;
 
     for (const auto& param : parameters) {
-        nljson param_value = resolve_swagger_ref(param, swagger);
+        nljson param_value = resolve_swagger_ref(param, refs);
 
         if (!param_value.contains("name") || !param_value.contains("in")) {
             continue;
@@ -216,7 +343,7 @@ std::pair<Variables, Parameters> import_swagger_parameters(const nljson& paramet
                 break;
             }
         } else if (param_value.contains("schema")) {
-            value = unpack_variables(import_schema_example(param_value.at("schema"), swagger), 0);
+            value = unpack_variables(import_schema_example(param_value.at("schema"), refs), 0);
             find_and_replace(value, "\n", "");
         }
 
@@ -242,116 +369,289 @@ std::pair<Variables, Parameters> import_swagger_parameters(const nljson& paramet
     return {vars, params};
 }
 
-void AppState::import_swagger_paths(const nljson& paths, const nljson& swagger) noexcept {
-    for (auto path = paths.begin(); path != paths.end(); path++) {
-        std::string endpoint = "{url}" + path.key();
+static SwaggerPathImport import_swagger_path(const std::string& path, const nljson& item,
+                                             SwaggerRefCache& refs) noexcept {
+    std::string endpoint = "{url}" + path;
 
-        nljson value = resolve_swagger_ref(path.value(), swagger);
+    nljson value = resolve_swagger_ref(item, refs);
 
-        auto group_id = ++this->id_counter;
-        {
-            auto new_group = Group{
+    SwaggerPathImport result = {
+        .group =
+            Group{
                 .parent_id = 0,
-                .id = group_id,
+                .id = 0,
                 .flags = GROUP_OPEN,
                 .name = endpoint,
                 .cli_settings = {},
                 .children_ids = {},
                 .variables = {},
-            };
-            this->root_group()->children_ids.push_back(group_id);
-            this->tests.emplace(group_id, new_group);
+            },
+        .tests = {},
+    };
+
+    Parameters group_params;
+    if (value.contains("parameters")) {
+        auto [vars, params] = import_swagger_parameters(value.at("parameters"), refs);
+        result.group.variables = vars;
+        group_params = params;
+    }
+
+    const auto& operations = value;
+    for (auto op = operations.begin(); op != operations.end(); op++) {
+        HTTPType type = http_type_from_label(op.key());
+        if (type == static_cast<HTTPType>(-1)) {
+            continue; // Skip over unknown
         }
-        Group& new_group = std::get<Group>(this->tests.at(group_id));
 
-        Parameters group_params;
-        if (value.contains("parameters")) {
-            value.at("parameters");
+        Test& new_test = result.tests.emplace_back(Test{
+            .parent_id = 0,
+            .id = 0,
+            .flags = TEST_NONE,
+
+            .type = type,
+            .endpoint = endpoint,
+
+            .request = {.parameters = group_params},
+            .response = {},
 
-            auto [vars, params] = import_swagger_parameters(value.at("parameters"), swagger);
-            new_group.variables = vars;
-            group_params = params;
+            .cli_settings = {},
+        });
+
+        // Variables/Parameters
+
+        if (op.value().contains("parameters")) {
+            auto [vars, params] = import_swagger_parameters(op.value().at("parameters"), refs);
+            new_test.variables = vars;
+            std::copy(params.elements.begin(), params.elements.end(),
+                      std::back_inserter(new_test.request.parameters.elements));
         }
 
-        auto group_vars = this->get_test_variables(group_id);
-        const auto& operations = value;
-        for (auto op = operations.begin(); op != operations.end(); op++) {
-            HTTPType type = http_type_from_label(op.key());
-            if (type == static_cast<HTTPType>(-1)) {
-                continue; // Skip over unknown
-            }
+        // Body
 
-            auto test_id = ++this->id_counter;
-            {
-                auto new_test = Test{
-                    .parent_id = group_id,
-                    .id = test_id,
-                    .flags = TEST_NONE,
+        if (op.value().contains("requestBody")) {
+            nljson body_value = resolve_swagger_ref(op.value().at("requestBody"), refs);
 
-                    .type = type,
-                    .endpoint = endpoint,
+            if (body_value.contains("content")) {
+                const auto& content = body_value.at("content");
+                for (auto it = content.begin(); it != content.end(); it++) {
+                    std::string content_type = it.key();
+                    const auto& media_type = it.value();
 
-                    .request = {.parameters = group_params},
-                    .response = {},
+                    new_test.request.body_type = request_body_type(content_type);
 
-                    .cli_settings = {},
-                };
+                    if (new_test.request.body_type == REQUEST_OTHER) {
+                        new_test.request.other_content_type = content_type;
+                    }
 
-                new_group.children_ids.push_back(test_id);
-                this->tests.emplace(test_id, new_test);
-            }
-            Test& new_test = std::get<Test>(this->tests.at(test_id));
+                    if (media_type.contains("example")) {
+                        new_test.request.body = media_type.at("example").dump(4);
 
-            // Variables/Parameters
+                        if (new_test.request.body_type == REQUEST_MULTIPART) {
+                            request_body_convert<REQUEST_MULTIPART>(&new_test);
+                        }
+                    } else if (media_type.contains("schema")) {
+                        new_test.request.body = unpack_variables(
+                            import_schema_example(media_type.at("schema"), refs), 4);
+                    }
 
-            if (op.value().contains("parameters")) {
-                auto [vars, params] =
-                    import_swagger_parameters(op.value().at("parameters"), swagger);
-                new_test.variables = vars;
-                std::copy(params.elements.begin(), params.elements.end(),
-                          std::back_inserter(new_test.request.parameters.elements));
+                    // TODO: Multiple tests for each content-type
+                    //
+                    // Right now only use the first provided
+                    break;
+                }
             }
+        }
+    }
 
-            test_resolve_url_variables(group_vars, &new_test);
+    return result;
+}
 
-            // Body
+void AppState::import_swagger_merge(std::vector<SwaggerPathImport>&& imported) noexcept {
+    // Paths are sorted like keys of a parsed document, ids don't depend on which finished first
+    std::stable_sort(imported.begin(), imported.end(),
+                     [](const SwaggerPathImport& a, const SwaggerPathImport& b) {
+                         return a.group.name < b.group.name;
+                     });
+
+    for (SwaggerPathImport& path : imported) {
+        size_t group_id = ++this->id_counter;
+        path.group.id = group_id;
+        path.group.children_ids.reserve(path.tests.size());
+        this->root_group()->children_ids.push_back(group_id);
+        this->tests.emplace(group_id, std::move(path.group));
+
+        VariablesMap group_vars = this->get_test_variables(group_id);
+        Group& group = std::get<Group>(this->tests.at(group_id));
+        for (Test& test : path.tests) {
+            test.id = ++this->id_counter;
+            test.parent_id = group_id;
+            test_resolve_url_variables(group_vars, &test);
+
+            group.children_ids.push_back(test.id);
+            this->tests.emplace(test.id, std::move(test));
+        }
+    }
+}
 
-            if (op.value().contains("requestBody")) {
-                nljson body_value = resolve_swagger_ref(op.value().at("requestBody"), swagger);
+// Builds json values out of SAX events
+struct SwaggerJsonBuilder {
+    nljson root;
+    std::vector<nljson*> stack;
+    std::string key;
 
-                if (body_value.contains("content")) {
-                    const auto& content = body_value.at("content");
-                    for (auto it = content.begin(); it != content.end(); it++) {
-                        std::string content_type = it.key();
-                        const auto& media_type = it.value();
+    nljson* add(nljson value) noexcept {
+        if (this->stack.empty()) {
+            this->root = std::move(value);
+            return &this->root;
+        }
 
-                        new_test.request.body_type = request_body_type(content_type);
+        // Only the innermost container is modified so pointers to outer ones stay valid
+        nljson& parent = *this->stack.back();
+        if (parent.is_array()) {
+            parent.push_back(std::move(value));
+            return &parent.back();
+        }
 
-                        if (new_test.request.body_type == REQUEST_OTHER) {
-                            new_test.request.other_content_type = content_type;
-                        }
+        nljson& slot = parent[this->key];
+        slot = std::move(value);
+        return &slot;
+    }
 
-                        if (media_type.contains("example")) {
-                            new_test.request.body = media_type.at("example").dump(4);
+    void begin(nljson container) noexcept {
+        this->stack.push_back(this->add(std::move(container)));
+    }
+    void end() noexcept { this->stack.pop_back(); }
+};
 
-                            if (new_test.request.body_type == REQUEST_MULTIPART) {
-                                request_body_convert<REQUEST_MULTIPART>(&new_test);
-                            }
-                        } else if (media_type.contains("schema")) {
-                            new_test.request.body = unpack_variables(
-                                import_schema_example(media_type.at("schema"), swagger), 4);
-                        }
+// Reads a swagger file in two passes so only a single path item is resident at a time
+// First pass builds everything except paths and collects external references
+// Second pass builds path items one by one and hands them to on_path
+struct SwaggerSax {
+    using number_integer_t = nljson::number_integer_t;
+    using number_unsigned_t = nljson::number_unsigned_t;
+    using number_float_t = nljson::number_float_t;
+    using string_t = nljson::string_t;
+    using binary_t = nljson::binary_t;
+
+    bool paths_pass = false;
+    std::function<void(const std::string&, nljson&&)> on_path;
+
+    SwaggerJsonBuilder document;
+    SwaggerJsonBuilder path_item;
+    std::string path;
+    bool has_paths = false;
+    std::unordered_set<std::string> locations;
+    // Set when a reference points into paths, they have to be kept in the document then
+    bool paths_referenced = false;
+
+    size_t depth = 0;
+    std::string section;
+    std::string last_key;
+    bool in_paths = false;
+
+    // Where the current event goes to, nullptr when it's skipped
+    SwaggerJsonBuilder* target() noexcept {
+        if (!this->in_paths) {
+            return this->paths_pass ? nullptr : &this->document;
+        }
+        // Inside of a path item
+        return this->paths_pass && this->depth >= 2 ? &this->path_item : nullptr;
+    }
 
-                        // TODO: Multiple tests for each content-type
-                        //
-                        // Right now only use the first provided
-                        break;
-                    }
-                }
+    bool value(nljson value) noexcept {
+        if (!this->paths_pass && this->last_key == "$ref" && value.is_string()) {
+            auto [location, local] = split_swagger_ref(value.get<std::string>());
+            if (!location.empty()) {
+                this->locations.insert(location);
+            } else if (local == "paths" || local.starts_with("paths/")) {
+                this->paths_referenced = true;
             }
         }
+        this->last_key.clear();
+
+        if (this->in_paths && this->depth == 2) {
+            return true; // Not a path item
+        }
+
+        if (SwaggerJsonBuilder* builder = this->target()) {
+            builder->add(std::move(value));
+        }
+        return true;
+    }
+
+    bool begin(nljson container) noexcept {
+        this->last_key.clear();
+
+        if (this->depth == 1 && this->section == "paths") {
+            this->in_paths = true;
+            this->has_paths = true;
+            this->depth++;
+            return true;
+        }
+
+        if (this->in_paths && this->depth == 2) {
+            this->path_item = {};
+        }
+
+        if (SwaggerJsonBuilder* builder = this->target()) {
+            builder->begin(std::move(container));
+        }
+        this->depth++;
+        return true;
+    }
+
+    bool end() noexcept {
+        this->depth--;
+
+        if (this->in_paths && this->depth == 1) {
+            this->in_paths = false;
+            return true;
+        }
+
+        if (SwaggerJsonBuilder* builder = this->target()) {
+            builder->end();
+        }
+
+        if (this->paths_pass && this->in_paths && this->depth == 2) {
+            this->on_path(this->path, std::move(this->path_item.root));
+            this->path_item = {};
+        }
+        return true;
+    }
+
+    bool null() noexcept { return this->value(nullptr); }
+    bool boolean(bool val) noexcept { return this->value(val); }
+    bool number_integer(number_integer_t val) noexcept { return this->value(val); }
+    bool number_unsigned(number_unsigned_t val) noexcept { return this->value(val); }
+    bool number_float(number_float_t val, const string_t&) noexcept { return this->value(val); }
+    bool string(string_t& val) noexcept { return this->value(std::move(val)); }
+    bool binary(binary_t& val) noexcept { return this->value(nljson::binary(std::move(val))); }
+
+    bool start_object(size_t) noexcept { return this->begin(nljson::object()); }
+    bool end_object() noexcept { return this->end(); }
+    bool start_array(size_t) noexcept { return this->begin(nljson::array()); }
+    bool end_array() noexcept { return this->end(); }
+
+    bool key(string_t& val) noexcept {
+        if (this->depth == 1) {
+            this->section = val;
+        }
+        if (this->in_paths && this->depth == 2) {
+            this->path = val;
+        }
+
+        if (SwaggerJsonBuilder* builder = this->target()) {
+            builder->key = val;
+        }
+        this->last_key = std::move(val);
+        return true;
     }
-}
+
+    bool parse_error(size_t position, const std::string&, const nljson::exception& ex) noexcept {
+        Log(LogLevel::Error, "Failed to parse swagger at %zu: %s", position, ex.what());
+        return false;
+    }
+};
 
 void AppState::import_swagger(const std::string& swagger_file) noexcept {
     std::ifstream in(swagger_file);
@@ -360,10 +660,12 @@ void AppState::import_swagger(const std::string& swagger_file) noexcept {
         return;
     }
 
-    nljson swagger = nljson::parse(in, nullptr, false);
-    if (swagger.is_discarded()) {
+    // Paths are the bulk of big specs so they are skipped here and streamed later
+    SwaggerSax first_pass;
+    if (!nljson::sax_parse(in, &first_pass)) {
         return;
     }
+    const nljson& swagger = first_pass.document.root;
 
     this->tree_view.selected_tests.clear();
     this->tests = {
@@ -373,7 +675,9 @@ void AppState::import_swagger(const std::string& swagger_file) noexcept {
     this->saved_file = {};
     this->id_counter = 0;
     this->test_results.clear();
+    results_clear(this);
     this->tree_view.filtered_tests.clear();
+    this->search.rebuild = true;
     this->editor.open_tabs.clear();
 
     try {
@@ -390,8 +694,60 @@ void AppState::import_swagger(const std::string& swagger_file) noexcept {
             Log(LogLevel::Warning, "Failed to import swagger servers");
         }
 
-        if (swagger.contains("paths")) {
-            import_swagger_paths(swagger.at("paths"), swagger);
+        if (first_pass.has_paths) {
+            SwaggerRefCache refs = {.swagger = &swagger};
+            // Own threads for the import, thr_pool can be full of running tests
+            BS::thread_pool pool;
+            prefetch_swagger_documents(pool, refs, first_pass.locations);
+
+            in.clear();
+            in.seekg(0);
+
+            // Paths are converted in parallel, pending ones are limited so memory stays flat
+            size_t max_pending = pool.get_thread_count() * 4;
+            std::deque<std::future<SwaggerPathImport>> pending;
+            std::vector<SwaggerPathImport> imported;
+
+            auto convert = [&](const std::string& path, nljson&& item) {
+                if (pending.size() >= max_pending) {
+                    imported.push_back(pending.front().get());
+                    pending.pop_front();
+                }
+
+                pending.push_back(pool.submit_task(
+                    [path, item = std::move(item), &refs]() {
+                        return import_swagger_path(path, item, refs);
+                    }));
+            };
+
+            SwaggerSax paths_pass;
+            paths_pass.paths_pass = true;
+            bool parsed;
+            if (first_pass.paths_referenced) {
+                // Every path item has to be resolvable before any of them is converted
+                nljson& paths = first_pass.document.root["paths"];
+                paths = nljson::object();
+                paths_pass.on_path = [&paths](const std::string& path, nljson&& item) {
+                    paths[path] = std::move(item);
+                };
+                parsed = nljson::sax_parse(in, &paths_pass);
+
+                for (const auto& [path, item] : paths.items()) {
+                    convert(path, nljson(item));
+                }
+            } else {
+                paths_pass.on_path = convert;
+                parsed = nljson::sax_parse(in, &paths_pass);
+            }
+
+            for (auto& future : pending) {
+                imported.push_back(future.get());
+            }
+            this->import_swagger_merge(std::move(imported));
+
+            if (!parsed) {
+                Log(LogLevel::Error, "Failed to import swagger paths");
+            }
         } else {
             Log(LogLevel::Warning, "Failed to import swagger paths");
         }
@@ -440,13 +796,6 @@ void to_json(nljson& j, const RequestBody& request_body) noexcept {
     }
 }
 
-struct Operation {
-    std::string path;
-    HTTPType type;
-    std::vector<Parameter> parameters;
-    std::optional<RequestBody> request_body;
-};
-
 nljson export_example(const std::string& value_str) noexcept {
     auto value = nljson::parse(value_str, nullptr, false);
     if (value.is_discarded()) {
@@ -482,17 +831,135 @@ nljson export_schema(const nljson& example) {
 }
 } // namespace swagger_export
 
-void AppState::export_swagger_paths(nlohmann::json& swagger) const noexcept {
+static std::string lower_http_type_label(HTTPType type) noexcept {
+    std::string label = HTTPTypeLabels[type];
+    std::for_each(label.begin(), label.end(), [](char& c) { c = std::tolower(c); });
+    return label;
+}
+
+static nljson export_swagger_operation(const AppState* app, const Test* test,
+                                       const std::string& operation_id) {
     using namespace swagger_export;
-    std::unordered_map<std::string, Operation> paths;
 
-    size_t it_id = 0, it_idx = 0;
+    const VariablesMap& vars = app->get_test_variables(test->id);
+    std::string path = split_endpoint(test->endpoint).second;
+    std::vector<Parameter> parameters;
 
-    auto lower_http_type_label = [](HTTPType type) -> std::string {
-        std::string label = HTTPTypeLabels[type];
-        std::for_each(label.begin(), label.end(), [](char& c) { c = std::tolower(c); });
-        return label;
-    };
+    // Url params
+    std::vector<std::string> params = parse_url_params(path);
+
+    for (auto& param : params) {
+        std::optional<nljson> example = std::nullopt;
+
+        if (vars.contains(param)) {
+            example = export_example(vars.at(param));
+        }
+
+        parameters.push_back({
+            .name = param,
+            .in = "path",
+            .schema = export_schema(example.value_or(nljson::string_t{})),
+            .example = example,
+        });
+    }
+
+    // Header params
+    for (auto& header : test->request.headers.elements) {
+        if (header.flags & PARTIAL_DICT_ELEM_ENABLED) {
+            bool common = false;
+
+            for (size_t i = 0; i < ARRAY_SIZE(RequestHeadersLabels); i++) {
+                if (header.key == RequestHeadersLabels[i]) {
+                    common = true;
+                    break;
+                }
+            }
+
+            if (!common) {
+                nljson example = export_example(replace_variables(vars, header.data.data));
+
+                parameters.push_back({
+                    .name = header.key,
+                    .in = "header",
+                    .schema = export_schema(example),
+                    .example = example,
+                });
+            }
+        }
+    }
+
+    // Query params
+    for (auto& query : test->request.parameters.elements) {
+        if (query.flags & PARTIAL_DICT_ELEM_ENABLED) {
+            nljson example = export_example(replace_variables(vars, query.data.data));
+
+            parameters.push_back({
+                .name = query.key,
+                .in = "query",
+                .schema = export_schema(example),
+                .example = example,
+            });
+        }
+    }
+
+    // Cookie params
+    for (auto& cookie : test->request.cookies.elements) {
+        if (cookie.flags & PARTIAL_DICT_ELEM_ENABLED) {
+            nljson example = export_example(replace_variables(vars, cookie.data.data));
+
+            parameters.push_back({
+                .name = cookie.key,
+                .in = "cookie",
+                .schema = export_schema(example),
+                .example = example,
+            });
+        }
+    }
+
+    nljson operation = {};
+
+    operation.emplace("operationId", operation_id);
+    operation.emplace("parameters", parameters);
+
+    // Request body
+    if (!std::visit(EmptyVisitor(), test->request.body)) {
+        std::string media_type = to_string(request_content_type(&test->request));
+        std::optional<nljson> example = std::nullopt;
+        if (std::holds_alternative<std::string>(test->request.body)) {
+            example = export_example(
+                replace_variables(vars, std::get<std::string>(test->request.body)));
+        }
+
+        nljson schema_json = nljson::string_t{};
+        if (example.has_value()) {
+            schema_json = example.value();
+        }
+
+        operation.emplace("requestBody", swagger_export::RequestBody{
+                                             .media_type = media_type,
+                                             .schema = export_schema(schema_json),
+                                             .example = example,
+                                         });
+    }
+
+    operation.emplace("responses", nljson::parse(R"json(
+    {
+        "200": {
+            "description": "Ok"
+        }
+    }
+    )json"));
+
+    return operation;
+}
+
+void AppState::export_swagger_paths(JsonWriter& writer) const {
+    // Only ids are collected first, operations are built and written one at a time
+    // Sorted so operations of a path end up together
+    std::map<std::string, std::map<std::string, std::pair<std::string, size_t>>> paths;
+    std::unordered_set<std::string> operation_ids;
+
+    size_t it_id = 0, it_idx = 0;
 
     while (it_id != -1 && !this->root_group()->children_ids.empty()) {
         assert(this->tests.contains(it_id));
@@ -508,116 +975,17 @@ void AppState::export_swagger_paths(nlohmann::json& swagger) const noexcept {
         if (std::holds_alternative<Test>(*it_nt)) {
             const Test* it_test = &std::get<Test>(*it_nt);
             if (!(it_test->flags & TEST_DISABLED) && !this->parent_disabled(it_test->id)) {
-                const VariablesMap& vars = this->get_test_variables(it_test->id);
-
                 std::string path = split_endpoint(it_test->endpoint).second;
+                std::string label = lower_http_type_label(it_test->type);
 
-                std::string name = lower_http_type_label(it_test->type) + "_" + path;
+                std::string name = label + "_" + path;
                 find_and_replace(name, "/", "_");
                 find_and_replace(name, "{", "");
                 find_and_replace(name, "}", "");
 
-                if (!paths.contains(name)) {
-                    Operation op = {.path = path, .type = it_test->type};
-
-                    // Url params
-                    std::vector<std::string> params = parse_url_params(path);
-
-                    for (auto& param : params) {
-                        std::optional<nljson> example = std::nullopt;
-
-                        if (vars.contains(param)) {
-                            example = export_example(vars.at(param));
-                        }
-
-                        op.parameters.push_back({
-                            .name = param,
-                            .in = "path",
-                            .schema = export_schema(example.value_or(nljson::string_t{})),
-                            .example = example,
-                        });
-                    }
-
-                    // Header params
-                    for (auto& header : it_test->request.headers.elements) {
-                        if (header.flags & PARTIAL_DICT_ELEM_ENABLED) {
-                            bool common = false;
-
-                            for (size_t i = 0; i < ARRAY_SIZE(RequestHeadersLabels); i++) {
-                                if (header.key == RequestHeadersLabels[i]) {
-                                    common = true;
-                                    break;
-                                }
-                            }
-
-                            if (!common) {
-                                nljson example =
-                                    export_example(replace_variables(vars, header.data.data));
-
-                                op.parameters.push_back({
-                                    .name = header.key,
-                                    .in = "header",
-                                    .schema = export_schema(example),
-                                    .example = example,
-                                });
-                            }
-                        }
-                    }
-
-                    // Query params
-                    for (auto& query : it_test->request.parameters.elements) {
-                        if (query.flags & PARTIAL_DICT_ELEM_ENABLED) {
-                            nljson example =
-                                export_example(replace_variables(vars, query.data.data));
-
-                            op.parameters.push_back({
-                                .name = query.key,
-                                .in = "query",
-                                .schema = export_schema(example),
-                                .example = example,
-                            });
-                        }
-                    }
-
-                    // Cookie params
-                    for (auto& cookie : it_test->request.cookies.elements) {
-                        if (cookie.flags & PARTIAL_DICT_ELEM_ENABLED) {
-                            nljson example =
-                                export_example(replace_variables(vars, cookie.data.data));
-
-                            op.parameters.push_back({
-                                .name = cookie.key,
-                                .in = "cookie",
-                                .schema = export_schema(example),
-                                .example = example,
-                            });
-                        }
-                    }
-
-                    // Request body
-                    if (!std::visit(EmptyVisitor(), it_test->request.body)) {
-                        std::string media_type = to_string(request_content_type(&it_test->request));
-                        std::optional<nljson> example = std::nullopt;
-                        if (std::holds_alternative<std::string>(it_test->request.body)) {
-                            example = export_example(replace_variables(
-                                vars, std::get<std::string>(it_test->request.body)));
-                        }
-
-                        nljson schema_json = nljson::string_t{};
-                        if (example.has_value()) {
-                            schema_json = example.value();
-                        }
-
-                        nljson export_schema_json = export_schema(schema_json);
-
-                        op.request_body = swagger_export::RequestBody{
-                            .media_type = media_type,
-                            .schema = export_schema_json,
-                            .example = example,
-                        };
-                    }
-
-                    paths.emplace(name, op);
+                // First one wins
+                if (operation_ids.insert(name).second) {
+                    paths[path].try_emplace(label, name, it_test->id);
                 }
             }
         }
@@ -625,30 +993,24 @@ void AppState::export_swagger_paths(nlohmann::json& swagger) const noexcept {
         iterate_over_nested_children(this, &it_id, &it_idx, -1);
     }
 
-    swagger.emplace("paths", nljson::object());
-    for (const auto& [id, op] : paths) {
-        nljson operation = {};
-
-        operation.emplace("operationId", id);
-        operation.emplace("parameters", op.parameters);
-        if (op.request_body.has_value()) {
-            operation.emplace("requestBody", op.request_body.value());
+    writer.key("paths");
+    writer.begin_object();
+    for (const auto& [path, operations] : paths) {
+        writer.key(path);
+        writer.begin_object();
+        for (const auto& [label, operation] : operations) {
+            const auto& [name, id] = operation;
+            assert(this->tests.contains(id));
+
+            writer.key(label);
+            writer.value(export_swagger_operation(this, &std::get<Test>(this->tests.at(id)), name));
         }
-
-        operation.emplace("responses", nljson::parse(R"json(
-        {
-            "200": {
-                "description": "Ok"
-            }
-        }
-        )json"));
-
-        swagger.at("paths").emplace(op.path, nljson::object());
-        swagger.at("paths").at(op.path).emplace(lower_http_type_label(op.type), operation);
+        writer.end_object();
     }
+    writer.end_object();
 }
 
-void AppState::export_swagger_servers(nlohmann::json& swagger) const noexcept {
+void AppState::export_swagger_servers(JsonWriter& writer) const {
     VariablesMap root_vars = this->get_test_variables(0);
     if (root_vars.contains("url")) {
         nljson servers = {};
@@ -668,7 +1030,8 @@ void AppState::export_swagger_servers(nlohmann::json& swagger) const noexcept {
             servers.back().emplace("variables", variables);
         }
 
-        swagger.emplace("servers", servers);
+        writer.key("servers");
+        writer.value(servers);
     }
 }
 
@@ -680,21 +1043,31 @@ void AppState::export_swagger(const std::string& swagger_file) const noexcept {
     }
 
     try {
-        nljson swagger = {};
-        swagger.emplace("openapi", "3.0.0"); // Version
+        // Keys are written in the order json::dump would sort them
+        JsonWriter writer = {.os = &out, .indent = 2};
+        writer.begin_object();
 
         {
             nljson info = {};
             info.emplace("title", this->root_group()->name);
             info.emplace("version", "0.1.0");
 
-            swagger.emplace("info", info);
+            writer.key("info");
+            writer.value(info);
         }
 
-        this->export_swagger_servers(swagger);
-        this->export_swagger_paths(swagger);
+        writer.key("openapi");
+        writer.value("3.0.0"); // Version
 
-        out << swagger.dump(2);
+        this->export_swagger_paths(writer);
+        this->export_swagger_servers(writer);
+
+        writer.end_object();
+
+        if (!out.flush()) {
+            Log(LogLevel::Error, "Failed to write file %s", swagger_file.c_str());
+            return;
+        }
         Log(LogLevel::Info, "Successfully exported swagger to '%s'", swagger_file.c_str());
     } catch (nljson::type_error& te) {
         Log(LogLevel::Error, "Failed to export swagger: %s", te.what());
@@ -0,0 +1,480 @@
+#include "chunks.hpp"
+
+#include "array"
+#include "bit"
+#include "cstring"
+#include "filesystem"
+#include "fstream"
+#include "sstream"
+#include "unordered_map"
+
+static constexpr char MANIFEST_MAGIC[4] = {'W', 'T', 'C', 'M'};
+static constexpr uint8_t MANIFEST_VERSION = 1;
+
+static constexpr char DELTA_MAGIC[4] = {'W', 'T', 'D', 'L'};
+static constexpr uint8_t DELTA_VERSION = 1;
+
+enum DeltaOp : uint8_t {
+    DELTA_COPY = 0,   // offset and size in base
+    DELTA_INSERT = 1, // size followed by data
+};
+
+// Only the top bits are checked since they depend on the last 64 bytes
+static constexpr uint64_t CHUNK_MASK = ~uint64_t{0}
+                                       << (64 - std::countr_zero(CHUNK_AVG_SIZE));
+
+static_assert(std::has_single_bit(CHUNK_AVG_SIZE));
+static_assert(CHUNK_MIN_SIZE < CHUNK_AVG_SIZE && CHUNK_AVG_SIZE < CHUNK_MAX_SIZE);
+
+// Random values for the gear hash, generated with splitmix64 so they stay the same everywhere
+static constexpr std::array<uint64_t, 256> make_gear_table() noexcept {
+    std::array<uint64_t, 256> table = {};
+    uint64_t state = 0x7765657465650000; // "weetee"
+    for (uint64_t& value : table) {
+        state += 0x9e3779b97f4a7c15;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        value = z ^ (z >> 31);
+    }
+    return table;
+}
+
+static constexpr std::array<uint64_t, 256> GEAR_TABLE = make_gear_table();
+
+std::vector<size_t> chunk_boundaries(std::string_view data) noexcept {
+    std::vector<size_t> result;
+    result.reserve(data.size() / CHUNK_AVG_SIZE + 1);
+
+    size_t start = 0;
+    while (start < data.size()) {
+        size_t end = std::min(start + CHUNK_MAX_SIZE, data.size());
+        size_t idx = std::min(start + CHUNK_MIN_SIZE, end);
+
+        uint64_t hash = 0;
+        for (; idx < end; idx++) {
+            hash = (hash << 1) + GEAR_TABLE[static_cast<uint8_t>(data[idx])];
+            if ((hash & CHUNK_MASK) == 0) {
+                idx++; // Include the byte that matched
+                break;
+            }
+        }
+
+        result.push_back(idx);
+        start = idx;
+    }
+
+    return result;
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) noexcept { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t fmix64(uint64_t k) noexcept {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccd;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53;
+    k ^= k >> 33;
+    return k;
+}
+
+ChunkHash chunk_hash(std::string_view data) noexcept {
+    constexpr uint64_t c1 = 0x87c37b91114253d5;
+    constexpr uint64_t c2 = 0x4cf5ad432745937f;
+
+    const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    size_t len = data.size();
+    size_t nblocks = len / 16;
+
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+
+    for (size_t i = 0; i < nblocks; i++) {
+        uint64_t k1, k2;
+        memcpy(&k1, bytes + i * 16, sizeof(k1));
+        memcpy(&k2, bytes + i * 16 + 8, sizeof(k2));
+
+        k1 *= c1;
+        k1 = rotl64(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+
+        h1 = rotl64(h1, 27);
+        h1 += h2;
+        h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2;
+        k2 = rotl64(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+
+        h2 = rotl64(h2, 31);
+        h2 += h1;
+        h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const uint8_t* tail = bytes + nblocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+
+    switch (len & 15) {
+    case 15: k2 ^= uint64_t{tail[14]} << 48; [[fallthrough]];
+    case 14: k2 ^= uint64_t{tail[13]} << 40; [[fallthrough]];
+    case 13: k2 ^= uint64_t{tail[12]} << 32; [[fallthrough]];
+    case 12: k2 ^= uint64_t{tail[11]} << 24; [[fallthrough]];
+    case 11: k2 ^= uint64_t{tail[10]} << 16; [[fallthrough]];
+    case 10: k2 ^= uint64_t{tail[9]} << 8; [[fallthrough]];
+    case 9:
+        k2 ^= uint64_t{tail[8]};
+        k2 *= c2;
+        k2 = rotl64(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+        [[fallthrough]];
+    case 8: k1 ^= uint64_t{tail[7]} << 56; [[fallthrough]];
+    case 7: k1 ^= uint64_t{tail[6]} << 48; [[fallthrough]];
+    case 6: k1 ^= uint64_t{tail[5]} << 40; [[fallthrough]];
+    case 5: k1 ^= uint64_t{tail[4]} << 32; [[fallthrough]];
+    case 4: k1 ^= uint64_t{tail[3]} << 24; [[fallthrough]];
+    case 3: k1 ^= uint64_t{tail[2]} << 16; [[fallthrough]];
+    case 2: k1 ^= uint64_t{tail[1]} << 8; [[fallthrough]];
+    case 1:
+        k1 ^= uint64_t{tail[0]};
+        k1 *= c1;
+        k1 = rotl64(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+    }
+
+    h1 ^= len;
+    h2 ^= len;
+
+    h1 += h2;
+    h2 += h1;
+
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+
+    h1 += h2;
+    h2 += h1;
+
+    return ChunkHash{.lo = h1, .hi = h2};
+}
+
+std::string ChunkHash::to_hex() const noexcept {
+    static constexpr char digits[] = "0123456789abcdef";
+
+    std::string result(32, '0');
+    for (size_t i = 0; i < 16; i++) {
+        result[15 - i] = digits[(this->hi >> (i * 4)) & 0xf];
+        result[31 - i] = digits[(this->lo >> (i * 4)) & 0xf];
+    }
+    return result;
+}
+
+std::optional<ChunkHash> ChunkHash::from_hex(std::string_view hex) noexcept {
+    if (hex.size() != 32) {
+        return std::nullopt;
+    }
+
+    ChunkHash result{};
+    for (size_t i = 0; i < 32; i++) {
+        uint64_t digit;
+        char c = hex[i];
+        if (c >= '0' && c <= '9') {
+            digit = static_cast<uint64_t>(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            digit = static_cast<uint64_t>(c - 'a' + 10);
+        } else {
+            return std::nullopt;
+        }
+
+        uint64_t& half = i < 16 ? result.hi : result.lo;
+        half = (half << 4) | digit;
+    }
+    return result;
+}
+
+bool ChunkManifest::write(std::ostream& os) const noexcept {
+    uint64_t count = this->chunks.size();
+
+    os.write(MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC));
+    os.write(reinterpret_cast<const char*>(&MANIFEST_VERSION), sizeof(MANIFEST_VERSION));
+    os.write(reinterpret_cast<const char*>(&this->size), sizeof(this->size));
+    os.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const ChunkHash& hash : this->chunks) {
+        os.write(reinterpret_cast<const char*>(&hash.lo), sizeof(hash.lo));
+        os.write(reinterpret_cast<const char*>(&hash.hi), sizeof(hash.hi));
+    }
+
+    return static_cast<bool>(os);
+}
+
+bool ChunkManifest::read(std::istream& is) noexcept {
+    char magic[sizeof(MANIFEST_MAGIC)] = {};
+    uint8_t version = 0;
+    uint64_t count = 0;
+
+    is.read(magic, sizeof(magic));
+    is.read(reinterpret_cast<char*>(&version), sizeof(version));
+    is.read(reinterpret_cast<char*>(&this->size), sizeof(this->size));
+    is.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!is || memcmp(magic, MANIFEST_MAGIC, sizeof(magic)) != 0 ||
+        version != MANIFEST_VERSION) {
+        return false;
+    }
+
+    // Every chunk holds at least one byte
+    if (count > this->size) {
+        return false;
+    }
+
+    this->chunks.clear();
+    // Don't trust the count for allocating
+    this->chunks.reserve(std::min<uint64_t>(count, 0x10000));
+    for (uint64_t i = 0; i < count; i++) {
+        ChunkHash hash{};
+        is.read(reinterpret_cast<char*>(&hash.lo), sizeof(hash.lo));
+        is.read(reinterpret_cast<char*>(&hash.hi), sizeof(hash.hi));
+        if (!is) {
+            return false;
+        }
+        this->chunks.push_back(hash);
+    }
+
+    return true;
+}
+
+std::string ChunkStore::chunk_path(const ChunkHash& hash) const noexcept {
+    return (std::filesystem::path(this->dir) / hash.to_hex()).string();
+}
+
+std::optional<ChunkManifest> ChunkStore::store(std::string_view data) const noexcept {
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::create_directories(this->dir, ec);
+
+    ChunkManifest manifest{.size = data.size(), .chunks = {}};
+
+    size_t start = 0;
+    for (size_t end : chunk_boundaries(data)) {
+        std::string_view chunk = data.substr(start, end - start);
+        start = end;
+
+        ChunkHash hash = chunk_hash(chunk);
+        manifest.chunks.push_back(hash);
+
+        std::string path = this->chunk_path(hash);
+        if (fs::exists(path, ec)) {
+            continue;
+        }
+
+        // Written under a temporary name so an interrupted write never leaves a broken chunk
+        std::string tmp_path = path + ".tmp";
+        {
+            std::ofstream out(tmp_path, std::ios::binary);
+            out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            if (!out) {
+                fs::remove(tmp_path, ec);
+                return std::nullopt;
+            }
+        }
+
+        fs::rename(tmp_path, path, ec);
+        if (ec) {
+            fs::remove(tmp_path, ec);
+            return std::nullopt;
+        }
+    }
+
+    return manifest;
+}
+
+std::optional<std::string> ChunkStore::assemble(const ChunkManifest& manifest) const noexcept {
+    std::string result;
+    result.reserve(manifest.size);
+
+    for (const ChunkHash& hash : manifest.chunks) {
+        std::ifstream in(this->chunk_path(hash), std::ios::binary);
+        if (!in) {
+            return std::nullopt;
+        }
+
+        std::stringstream chunk;
+        chunk << in.rdbuf();
+        std::string chunk_data = chunk.str();
+        if (chunk_data.size() > CHUNK_MAX_SIZE || !(chunk_hash(chunk_data) == hash)) {
+            return std::nullopt;
+        }
+
+        result += chunk_data;
+    }
+
+    if (result.size() != manifest.size) {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+size_t ChunkStore::collect_garbage(const std::unordered_set<ChunkHash>& live) const noexcept {
+    namespace fs = std::filesystem;
+
+    size_t removed = 0;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(this->dir, ec)) {
+        std::optional<ChunkHash> hash = ChunkHash::from_hex(entry.path().filename().string());
+        if (!hash.has_value() || live.contains(hash.value())) {
+            continue;
+        }
+
+        if (fs::remove(entry.path(), ec)) {
+            removed++;
+        }
+    }
+
+    return removed;
+}
+
+static void append_u64(std::string& out, uint64_t value) noexcept {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void append_hash(std::string& out, const ChunkHash& hash) noexcept {
+    append_u64(out, hash.lo);
+    append_u64(out, hash.hi);
+}
+
+std::string delta_encode(std::string_view base, std::string_view target) noexcept {
+    // Offset and size of every chunk in base by its hash
+    std::unordered_map<ChunkHash, std::pair<size_t, size_t>> base_chunks;
+    size_t start = 0;
+    for (size_t end : chunk_boundaries(base)) {
+        base_chunks.emplace(chunk_hash(base.substr(start, end - start)),
+                            std::make_pair(start, end - start));
+        start = end;
+    }
+
+    std::string result;
+    result.append(DELTA_MAGIC, sizeof(DELTA_MAGIC));
+    result.push_back(static_cast<char>(DELTA_VERSION));
+    append_hash(result, chunk_hash(base));
+    append_hash(result, chunk_hash(target));
+    append_u64(result, target.size());
+
+    // Neighbouring copies and inserts are merged before being written
+    DeltaOp op = DELTA_COPY;
+    size_t op_offset = 0;
+    size_t op_size = 0;
+    auto flush = [&]() {
+        if (op_size == 0) {
+            return;
+        }
+
+        result.push_back(static_cast<char>(op));
+        if (op == DELTA_COPY) {
+            append_u64(result, op_offset);
+            append_u64(result, op_size);
+        } else {
+            append_u64(result, op_size);
+            result.append(target.substr(op_offset, op_size));
+        }
+        op_size = 0;
+    };
+
+    start = 0;
+    for (size_t end : chunk_boundaries(target)) {
+        std::string_view chunk = target.substr(start, end - start);
+
+        auto it = base_chunks.find(chunk_hash(chunk));
+        if (it != base_chunks.end() && base.substr(it->second.first, it->second.second) == chunk) {
+            size_t offset = it->second.first;
+            if (op != DELTA_COPY || op_offset + op_size != offset) {
+                flush();
+                op = DELTA_COPY;
+                op_offset = offset;
+            }
+        } else if (op != DELTA_INSERT) {
+            flush();
+            op = DELTA_INSERT;
+            op_offset = start;
+        }
+        op_size += chunk.size();
+
+        start = end;
+    }
+    flush();
+
+    return result;
+}
+
+std::optional<std::string> delta_apply(std::string_view base, std::string_view delta) noexcept {
+    size_t idx = 0;
+    auto read = [&](void* ptr, size_t size) {
+        if (delta.size() - idx < size) {
+            return false;
+        }
+        memcpy(ptr, delta.data() + idx, size);
+        idx += size;
+        return true;
+    };
+
+    char magic[sizeof(DELTA_MAGIC)] = {};
+    uint8_t version = 0;
+    ChunkHash base_hash{};
+    ChunkHash target_hash{};
+    uint64_t target_size = 0;
+    if (!read(magic, sizeof(magic)) || memcmp(magic, DELTA_MAGIC, sizeof(magic)) != 0 ||
+        !read(&version, sizeof(version)) || version != DELTA_VERSION ||
+        !read(&base_hash.lo, sizeof(base_hash.lo)) ||
+        !read(&base_hash.hi, sizeof(base_hash.hi)) ||
+        !read(&target_hash.lo, sizeof(target_hash.lo)) ||
+        !read(&target_hash.hi, sizeof(target_hash.hi)) ||
+        !read(&target_size, sizeof(target_size))) {
+        return std::nullopt;
+    }
+
+    if (!(chunk_hash(base) == base_hash)) {
+        return std::nullopt;
+    }
+
+    std::string result;
+    while (idx < delta.size()) {
+        uint8_t op = 0;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        if (!read(&op, sizeof(op))) {
+            return std::nullopt;
+        }
+
+        switch (op) {
+        case DELTA_COPY:
+            if (!read(&offset, sizeof(offset)) || !read(&size, sizeof(size)) ||
+                offset > base.size() || size > base.size() - offset) {
+                return std::nullopt;
+            }
+            result.append(base.substr(offset, size));
+            break;
+        case DELTA_INSERT:
+            if (!read(&size, sizeof(size)) || size > delta.size() - idx) {
+                return std::nullopt;
+            }
+            result.append(delta.substr(idx, size));
+            idx += size;
+            break;
+        default:
+            return std::nullopt;
+        }
+
+        if (result.size() > target_size) {
+            return std::nullopt;
+        }
+    }
+
+    if (result.size() != target_size || !(chunk_hash(result) == target_hash)) {
+        return std::nullopt;
+    }
+
+    return result;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "cstddef"
+#include "cstdint"
+#include "functional"
+#include "istream"
+#include "optional"
+#include "ostream"
+#include "string"
+#include "string_view"
+#include "unordered_set"
+#include "vector"
+
+// Content defined chunking, boundaries depend only on nearby bytes so an edit
+// only changes the chunks around it
+constexpr size_t CHUNK_MIN_SIZE = 0x800;    // 2 KiB
+constexpr size_t CHUNK_AVG_SIZE = 0x2000;   // 8 KiB, must be a power of 2
+constexpr size_t CHUNK_MAX_SIZE = 0x10000;  // 64 KiB
+
+struct ChunkHash {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+
+    bool operator==(const ChunkHash& other) const noexcept = default;
+
+    // 32 lowercase hex digits
+    std::string to_hex() const noexcept;
+    static std::optional<ChunkHash> from_hex(std::string_view hex) noexcept;
+};
+
+template <> struct std::hash<ChunkHash> {
+    size_t operator()(const ChunkHash& chunk) const noexcept {
+        return chunk.lo ^ chunk.hi;
+    }
+};
+
+// MurmurHash3 x64 128
+ChunkHash chunk_hash(std::string_view data) noexcept;
+
+// Returns end offsets of every chunk, last one is always data.size()
+std::vector<size_t> chunk_boundaries(std::string_view data) noexcept;
+
+struct ChunkManifest {
+    uint64_t size = 0;
+    std::vector<ChunkHash> chunks;
+
+    bool write(std::ostream& os) const noexcept;
+    // Returns false when failed
+    bool read(std::istream& is) noexcept;
+};
+
+// Stores every chunk once as dir/<hash>, files referring to them are kept as manifests
+struct ChunkStore {
+    std::string dir;
+
+    std::string chunk_path(const ChunkHash& hash) const noexcept;
+
+    // Splits and writes chunks that are not stored yet
+    std::optional<ChunkManifest> store(std::string_view data) const noexcept;
+    // Reads and verifies every chunk
+    std::optional<std::string> assemble(const ChunkManifest& manifest) const noexcept;
+    // Removes chunks not referenced by any of live, returns amount removed
+    size_t collect_garbage(const std::unordered_set<ChunkHash>& live) const noexcept;
+};
+
+// Rebuilds target from base by copying chunks they share, the rest is inserted as is
+std::string delta_encode(std::string_view base, std::string_view target) noexcept;
+// Returns std::nullopt when delta is invalid or was made against a different base
+std::optional<std::string> delta_apply(std::string_view base, std::string_view delta) noexcept;
@@ -0,0 +1,237 @@
+#include "diff.hpp"
+
+#include "algorithm"
+#include "cassert"
+#include "unordered_map"
+
+// Lines are compared as ids so every comparison is a single integer one
+struct MyersDiff {
+    std::vector<uint32_t> a;
+    std::vector<uint32_t> b;
+    size_t max_cost;
+
+    std::vector<DiffRow>* out;
+
+    void removed(size_t a0, size_t a1) noexcept {
+        for (size_t x = a0; x < a1; x++) {
+            this->out->push_back({.op = DIFF_DELETE, .a = x, .b = 0});
+        }
+    }
+
+    void added(size_t b0, size_t b1) noexcept {
+        for (size_t y = b0; y < b1; y++) {
+            this->out->push_back({.op = DIFF_INSERT, .a = 0, .b = y});
+        }
+    }
+
+    // Finds a point on a shortest edit path between both corners
+    // Returns false when the path costs more than max_cost
+    bool bisect(size_t a0, size_t a1, size_t b0, size_t b1, size_t* split_a,
+                size_t* split_b) const noexcept {
+        assert(split_a && split_b);
+
+        const ptrdiff_t n = static_cast<ptrdiff_t>(a1 - a0);
+        const ptrdiff_t m = static_cast<ptrdiff_t>(b1 - b0);
+        const ptrdiff_t max_d =
+            std::min((n + m + 1) / 2, static_cast<ptrdiff_t>(std::max<size_t>(this->max_cost, 1)));
+        const ptrdiff_t offset = max_d;
+        const ptrdiff_t length = 2 * max_d + 2;
+
+        // Furthest x reached on every diagonal, forward from the start and backward from the end
+        std::vector<ptrdiff_t> forward(static_cast<size_t>(length), -1);
+        std::vector<ptrdiff_t> backward(static_cast<size_t>(length), -1);
+        forward[static_cast<size_t>(offset + 1)] = 0;
+        backward[static_cast<size_t>(offset + 1)] = 0;
+
+        const ptrdiff_t delta = n - m;
+        // Paths can only meet on forward steps when delta is odd
+        const bool front = delta % 2 != 0;
+
+        // Diagonals that left the grid aren't walked again
+        ptrdiff_t k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+
+        auto a_at = [this, a0](ptrdiff_t x) { return this->a[a0 + static_cast<size_t>(x)]; };
+        auto b_at = [this, b0](ptrdiff_t y) { return this->b[b0 + static_cast<size_t>(y)]; };
+        auto at = [](std::vector<ptrdiff_t>& v, ptrdiff_t i) -> ptrdiff_t& {
+            return v[static_cast<size_t>(i)];
+        };
+
+        for (ptrdiff_t d = 0; d < max_d; d++) {
+            for (ptrdiff_t k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+                ptrdiff_t k1_offset = offset + k1;
+                ptrdiff_t x1;
+                if (k1 == -d ||
+                    (k1 != d && at(forward, k1_offset - 1) < at(forward, k1_offset + 1))) {
+                    x1 = at(forward, k1_offset + 1);
+                } else {
+                    x1 = at(forward, k1_offset - 1) + 1;
+                }
+                ptrdiff_t y1 = x1 - k1;
+                while (x1 < n && y1 < m && a_at(x1) == b_at(y1)) {
+                    x1++;
+                    y1++;
+                }
+                at(forward, k1_offset) = x1;
+
+                if (x1 > n) {
+                    k1_end += 2;
+                } else if (y1 > m) {
+                    k1_start += 2;
+                } else if (front) {
+                    ptrdiff_t k2_offset = offset + delta - k1;
+                    if (k2_offset >= 0 && k2_offset < length && at(backward, k2_offset) != -1 &&
+                        x1 >= n - at(backward, k2_offset)) {
+                        *split_a = a0 + static_cast<size_t>(x1);
+                        *split_b = b0 + static_cast<size_t>(y1);
+                        return true;
+                    }
+                }
+            }
+
+            for (ptrdiff_t k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+                ptrdiff_t k2_offset = offset + k2;
+                ptrdiff_t x2;
+                if (k2 == -d ||
+                    (k2 != d && at(backward, k2_offset - 1) < at(backward, k2_offset + 1))) {
+                    x2 = at(backward, k2_offset + 1);
+                } else {
+                    x2 = at(backward, k2_offset - 1) + 1;
+                }
+                ptrdiff_t y2 = x2 - k2;
+                while (x2 < n && y2 < m && a_at(n - x2 - 1) == b_at(m - y2 - 1)) {
+                    x2++;
+                    y2++;
+                }
+                at(backward, k2_offset) = x2;
+
+                if (x2 > n) {
+                    k2_end += 2;
+                } else if (y2 > m) {
+                    k2_start += 2;
+                } else if (!front) {
+                    ptrdiff_t k1_offset = offset + delta - k2;
+                    if (k1_offset >= 0 && k1_offset < length && at(forward, k1_offset) != -1) {
+                        ptrdiff_t x1 = at(forward, k1_offset);
+                        ptrdiff_t y1 = offset + x1 - k1_offset;
+                        if (x1 >= n - x2) {
+                            *split_a = a0 + static_cast<size_t>(x1);
+                            *split_b = b0 + static_cast<size_t>(y1);
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void compare(size_t a0, size_t a1, size_t b0, size_t b1) noexcept {
+        while (a0 < a1 && b0 < b1 && this->a[a0] == this->b[b0]) {
+            this->out->push_back({.op = DIFF_EQUAL, .a = a0++, .b = b0++});
+        }
+
+        size_t suffix = 0;
+        while (a1 > a0 && b1 > b0 && this->a[a1 - 1] == this->b[b1 - 1]) {
+            a1--;
+            b1--;
+            suffix++;
+        }
+
+        size_t split_a, split_b;
+        if (a0 == a1) {
+            this->added(b0, b1);
+        } else if (b0 == b1) {
+            this->removed(a0, a1);
+        } else if (this->bisect(a0, a1, b0, b1, &split_a, &split_b) &&
+                   !(split_a == a0 && split_b == b0) && !(split_a == a1 && split_b == b1)) {
+            this->compare(a0, split_a, b0, split_b);
+            this->compare(split_a, a1, split_b, b1);
+        } else {
+            this->removed(a0, a1);
+            this->added(b0, b1);
+        }
+
+        for (size_t i = 0; i < suffix; i++) {
+            this->out->push_back({.op = DIFF_EQUAL, .a = a1 + i, .b = b1 + i});
+        }
+    }
+};
+
+std::vector<DiffRow> diff_lines(const std::vector<std::string_view>& a,
+                                const std::vector<std::string_view>& b,
+                                size_t max_cost) noexcept {
+    std::vector<DiffRow> result;
+    MyersDiff diff = {.a = {}, .b = {}, .max_cost = max_cost, .out = &result};
+
+    std::unordered_map<std::string_view, uint32_t> ids;
+    auto intern = [&ids](const std::vector<std::string_view>& lines,
+                         std::vector<uint32_t>* out) {
+        out->reserve(lines.size());
+        for (std::string_view line : lines) {
+            out->push_back(ids.try_emplace(line, static_cast<uint32_t>(ids.size())).first->second);
+        }
+    };
+    intern(a, &diff.a);
+    intern(b, &diff.b);
+
+    result.reserve(std::max(a.size(), b.size()));
+    diff.compare(0, a.size(), 0, b.size());
+    return result;
+}
+
+std::vector<DiffRow> diff_collapse(const std::vector<DiffRow>& rows, size_t context) noexcept {
+    std::vector<DiffRow> result;
+
+    for (size_t i = 0; i < rows.size();) {
+        if (rows[i].op != DIFF_EQUAL) {
+            result.push_back(rows[i++]);
+            continue;
+        }
+
+        size_t end = i;
+        while (end < rows.size() && rows[end].op == DIFF_EQUAL) {
+            end++;
+        }
+
+        // Runs at the edges only need context on their inner side
+        size_t keep_front = i == 0 ? 0 : context;
+        size_t keep_back = end == rows.size() ? 0 : context;
+        if (end - i > keep_front + keep_back + 1) {
+            result.insert(result.end(), rows.begin() + static_cast<ptrdiff_t>(i),
+                          rows.begin() + static_cast<ptrdiff_t>(i + keep_front));
+
+            const DiffRow& first = rows[i + keep_front];
+            result.push_back({
+                .op = DIFF_SKIP,
+                .a = first.a,
+                .b = first.b,
+                .skipped = end - i - keep_front - keep_back,
+            });
+
+            result.insert(result.end(), rows.begin() + static_cast<ptrdiff_t>(end - keep_back),
+                          rows.begin() + static_cast<ptrdiff_t>(end));
+        } else {
+            result.insert(result.end(), rows.begin() + static_cast<ptrdiff_t>(i),
+                          rows.begin() + static_cast<ptrdiff_t>(end));
+        }
+        i = end;
+    }
+
+    return result;
+}
+
+void diff_expand(std::vector<DiffRow>* rows, size_t row) noexcept {
+    assert(rows);
+    assert(row < rows->size() && rows->at(row).op == DIFF_SKIP);
+
+    DiffRow skip = rows->at(row);
+    std::vector<DiffRow> equal;
+    equal.reserve(skip.skipped);
+    for (size_t i = 0; i < skip.skipped; i++) {
+        equal.push_back({.op = DIFF_EQUAL, .a = skip.a + i, .b = skip.b + i});
+    }
+
+    auto it = rows->erase(rows->begin() + static_cast<ptrdiff_t>(row));
+    rows->insert(it, equal.begin(), equal.end());
+}
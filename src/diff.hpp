@@ -0,0 +1,49 @@
+#pragma once
+
+#include "cstddef"
+#include "cstdint"
+#include "string_view"
+#include "vector"
+
+// Edit cost after which a part is given up on and shown as removed and added whole,
+// keeps completely different inputs from taking quadratic time
+constexpr size_t DIFF_MAX_COST = 0x1000;
+// Equal lines kept around changes when collapsing
+constexpr size_t DIFF_CONTEXT = 3;
+
+enum DiffOp : uint8_t {
+    DIFF_EQUAL,
+    DIFF_DELETE,
+    DIFF_INSERT,
+    DIFF_SKIP,
+};
+
+struct DiffRow {
+    DiffOp op;
+    // Line in the old input, unused by DIFF_INSERT
+    size_t a;
+    // Line in the new input, unused by DIFF_DELETE
+    size_t b;
+    // Equal lines hidden by DIFF_SKIP starting at a and b
+    size_t skipped = 0;
+};
+
+// Myers diff in linear space, finds the middle of the edit path and recurses on both halves
+// Rows are in order and turn a into b
+std::vector<DiffRow> diff_lines(const std::vector<std::string_view>& a,
+                                const std::vector<std::string_view>& b,
+                                size_t max_cost = DIFF_MAX_COST) noexcept;
+
+// Replaces equal lines further than context from a change with a DIFF_SKIP row
+std::vector<DiffRow> diff_collapse(const std::vector<DiffRow>& rows,
+                                   size_t context = DIFF_CONTEXT) noexcept;
+
+// Puts the equal lines hidden by a DIFF_SKIP row back in its place
+void diff_expand(std::vector<DiffRow>* rows, size_t row) noexcept;
+
+struct DiffViewState {
+    // Diff the state belongs to, the state is reset when another diff is shown
+    const void* source = nullptr;
+    // Rows of the diff with the skipped parts that were expanded
+    std::vector<DiffRow> rows = {};
+};
@@ -26,6 +26,8 @@
 #include "textinputcombo.hpp"
 #include "utils.hpp"
 
+#include "algorithm"
+#include "cctype"
 #include "cmath"
 #include "cstdint"
 #include "optional"
@@ -562,6 +564,7 @@ bool show_tree_view_row(AppState* app, Group& group, ImVec2& min, ImVec2& max, s
     auto& io = ImGui::GetIO();
     if (clicked && !io.KeyShift && !io.KeyCtrl) {
         group.flags ^= GROUP_OPEN; // toggle
+        app->tree_view.rows_dirty = true;
     }
 
     if (!changed && !app->tree_view.selected_tests.contains(0) &&
@@ -587,32 +590,54 @@ bool show_tree_view_row(AppState* app, Group& group, ImVec2& min, ImVec2& max, s
 
     changed |= tree_view_context(app, id);
 
-    static constexpr float INDENTATION_INCREMENT = 22;
+    ImGui::PopID();
 
-    ImVec2 mouse = ImGui::GetIO().MousePos;
-    if (!changed && group.flags & GROUP_OPEN) {
-        size_t index = 1;
-        for (size_t child_id : group.children_ids) {
-            assert(app->tests.contains(child_id));
+    return changed;
+}
 
-            changed |= show_tree_view_row(app, app->tests.at(child_id), min, max, index,
-                                      indentation + INDENTATION_INCREMENT);
+static constexpr float INDENTATION_INCREMENT = 22;
 
-            if (changed) {
-                break;
-            }
+// Drop targets after open groups whose last visible row is rows[row_idx]
+bool tree_view_group_end_rows(AppState* app, size_t row_idx, ImVec2 min, ImVec2 max) noexcept {
+    const std::vector<TreeViewRow>& rows = app->tree_view.rows;
+    assert(row_idx < rows.size());
 
-            index += 1;
-        }
+    if (!ImGui::IsDragDropActive() || !vec2_intersect(ImGui::GetIO().MousePos, min, max)) {
+        return false;
+    }
 
-        // after the opened group
-        if (group.id != 0 && ImGui::IsDragDropActive() && vec2_intersect(mouse, min, max) &&
-            !app->tree_view.selected_tests.contains(id)) {
-            changed |= tree_view_dnd_target_row(app, group.parent_id, idx, indentation);
+    size_t next_depth = row_idx + 1 < rows.size() ? rows[row_idx + 1].depth : 0;
+    size_t id = rows[row_idx].id;
+    size_t depth = rows[row_idx].depth;
+
+    // Rows that aren't open groups can only end their parent
+    const NestedTest& nt = app->tests.at(id);
+    if (!std::holds_alternative<Group>(nt) || !(std::get<Group>(nt).flags & GROUP_OPEN)) {
+        if (id == 0) {
+            return false;
         }
+        id = std::visit(ParentIDVisitor(), nt);
+        depth -= 1;
     }
 
-    ImGui::PopID();
+    bool changed = false;
+    while (!changed && id != 0 && depth >= next_depth) {
+        const Group& group = std::get<Group>(app->tests.at(id));
+
+        if (!app->tree_view.selected_tests.contains(id)) {
+            const auto& siblings = std::get<Group>(app->tests.at(group.parent_id)).children_ids;
+            size_t idx = static_cast<size_t>(
+                std::find(siblings.begin(), siblings.end(), id) - siblings.begin() + 1);
+
+            ImGui::PushID(static_cast<int32_t>(id));
+            changed |= tree_view_dnd_target_row(app, group.parent_id, idx,
+                                                static_cast<float>(depth) * INDENTATION_INCREMENT);
+            ImGui::PopID();
+        }
+
+        id = group.parent_id;
+        depth -= 1;
+    }
 
     return changed;
 }
@@ -632,9 +657,27 @@ void tree_view(AppState* app) noexcept {
         ImGui::TableSetupColumn("enabled", ImGuiTableColumnFlags_WidthFixed, 23.0f);
         ImGui::TableSetupColumn("selectable", ImGuiTableColumnFlags_WidthFixed, 0.0f);
 
-        ImVec2 min;
-        ImVec2 max;
-        changed_data |= show_tree_view_row(app, app->tests[0], min, max, 0, 0.0f);
+        app->tree_view_rows_update();
+
+        // Rows refer to the tree as it was before a change so nothing is drawn after one
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(app->tree_view.rows.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd && !changed_data; i++) {
+                const TreeViewRow& row = app->tree_view.rows[static_cast<size_t>(i)];
+                assert(app->tests.contains(row.id));
+
+                ImVec2 min;
+                ImVec2 max;
+                changed_data |=
+                    show_tree_view_row(app, app->tests.at(row.id), min, max, row.idx,
+                                       static_cast<float>(row.depth) * INDENTATION_INCREMENT);
+
+                if (!changed_data) {
+                    changed_data |= tree_view_group_end_rows(app, static_cast<size_t>(i), min, max);
+                }
+            }
+        }
 
         ImGui::EndTable();
     }
@@ -644,7 +687,8 @@ void tree_view(AppState* app) noexcept {
     }
 
     if (changed_search || changed_data) {
-        app->filter(&app->tests[0]);
+        app->filter();
+        app->tree_view.rows_dirty = true;
     }
 
     ImGui::PopFont();
@@ -1261,6 +1305,261 @@ void show_httplib_cookies(AppState* app, const httplib::Headers& headers) noexce
     }
 }
 
+// Read only text with find, only lines in view are laid out
+void text_view(const char* label, const void* source, std::string_view text,
+               const std::vector<size_t>& lines, TextViewState* state, ImVec2 size) noexcept {
+    assert(state);
+
+    if (state->source != source) {
+        *state = TextViewState{.source = source};
+    }
+
+    ImGui::PushID(label);
+
+    TextSearch& search = state->search;
+
+    ImGui::SetNextItemWidth(250);
+    if (ImGui::InputTextWithHint("##find", ICON_FA_SEARCH " Find", &state->query)) {
+        search.reset(state->query);
+        state->jump = true;
+    }
+    bool next = ImGui::IsItemFocused() && ImGui::IsKeyPressed(ImGuiKey_Enter);
+
+    // Big texts are searched over a few frames
+    search.step(text);
+
+    ImGui::SameLine();
+    bool prev = ImGui::ArrowButton("##prev", ImGuiDir_Up);
+    ImGui::SameLine();
+    next |= ImGui::ArrowButton("##next", ImGuiDir_Down);
+
+    if (!search.matches.empty() && (prev || next)) {
+        size_t count = search.matches.size();
+        search.current = (search.current + (next ? 1 : count - 1)) % count;
+        state->jump = true;
+    }
+
+    ImGui::SameLine();
+    // Lines are drawn as plain text so they can't be selected
+    if (ImGui::Button(ICON_FA_COPY " Copy")) {
+        ImGui::SetClipboardText(std::string(text).c_str());
+    }
+
+    ImGui::SameLine();
+    if (!search.done(text)) {
+        ImGui::Text("%zu%%", search.scanned * 100 / std::max<size_t>(text.size(), 1));
+    } else if (!search.query.empty()) {
+        ImGui::Text("%zu/%zu", search.matches.empty() ? 0 : search.current + 1,
+                    search.matches.size());
+    }
+
+    if (ImGui::BeginChild("##text", size, ImGuiChildFlags_FrameStyle,
+                          ImGuiWindowFlags_HorizontalScrollbar)) {
+        float line_height = ImGui::GetTextLineHeightWithSpacing();
+
+        if (state->jump && search.current < search.matches.size()) {
+            state->jump = false;
+            size_t line = text_line_of(lines, search.matches[search.current]);
+            ImGui::SetScrollY(static_cast<float>(line) * line_height -
+                              ImGui::GetWindowHeight() / 2);
+        }
+
+        ImDrawList* draw_list = ImGui::GetWindowDrawList();
+        ImU32 match_color = ImGui::GetColorU32(ImGuiCol_TextSelectedBg);
+        ImU32 current_color = ImGui::GetColorU32(ImGuiCol_PlotHistogram, 0.6f);
+
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(lines.size()), line_height);
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                size_t line_idx = static_cast<size_t>(i);
+                std::string_view line = text_line(text, lines, line_idx);
+                size_t line_start = lines[line_idx];
+                ImVec2 pos = ImGui::GetCursorScreenPos();
+
+                auto match = std::lower_bound(search.matches.begin(), search.matches.end(),
+                                              line_start);
+                for (; match != search.matches.end() && *match < line_start + line.size();
+                     match++) {
+                    size_t begin = *match - line_start;
+                    size_t end = std::min(line.size(), begin + search.query.size());
+                    float x0 = ImGui::CalcTextSize(line.data(), line.data() + begin).x;
+                    float x1 = x0 + ImGui::CalcTextSize(line.data() + begin, line.data() + end).x;
+
+                    bool current = match - search.matches.begin() ==
+                                   static_cast<std::ptrdiff_t>(search.current);
+                    draw_list->AddRectFilled({pos.x + x0, pos.y},
+                                             {pos.x + x1, pos.y + ImGui::GetTextLineHeight()},
+                                             current ? current_color : match_color);
+                }
+
+                ImGui::TextUnformatted(line.data(), line.data() + line.size());
+            }
+        }
+    }
+    ImGui::EndChild();
+
+    ImGui::PopID();
+}
+
+// Collapsible view of a json tape, only rows in view are drawn
+void json_tree_view(const char* label, const void* source, const JsonTape& tape,
+                    std::string_view text, JsonTreeState* state, ImVec2 size) noexcept {
+    assert(state);
+
+    if (state->source != source) {
+        *state = JsonTreeState{.source = source};
+    }
+    state->update(tape);
+
+    ImGui::PushID(label);
+
+    if (ImGui::Button(ICON_FA_COPY " Copy")) {
+        ImGui::SetClipboardText(std::string(text).c_str());
+    }
+    ImGui::SameLine();
+    hint("Right click a row to copy only its value");
+
+    if (ImGui::BeginChild("##tree", size, ImGuiChildFlags_FrameStyle,
+                          ImGuiWindowFlags_HorizontalScrollbar)) {
+        static constexpr float INDENTATION = 16;
+        // Longer values are cut off, the whole value can still be copied
+        static constexpr size_t VALUE_MAX = 0x400;
+
+        std::optional<size_t> toggled = std::nullopt;
+
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(state->rows.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                const JsonTreeRow& row = state->rows.at(static_cast<size_t>(i));
+                const JsonTapeNode& node = tape.nodes.at(row.node);
+                const JsonTapeNode* parent =
+                    row.parent != -1ull ? &tape.nodes.at(row.parent) : nullptr;
+
+                std::string name;
+                if (parent != nullptr && parent->type == JSON_TAPE_ARRAY) {
+                    name = "[" + std::to_string(row.index) + "]: ";
+                } else if (parent != nullptr) {
+                    name = std::string(tape.key(text, node)) + ": ";
+                }
+
+                ImGui::PushID(i);
+                ImGui::SetCursorPosX(ImGui::GetCursorPosX() +
+                                     static_cast<float>(row.depth) * INDENTATION);
+
+                switch (node.type) {
+                case JSON_TAPE_ARRAY:
+                case JSON_TAPE_OBJECT: {
+                    bool open = state->open.contains(row.node);
+                    bool is_array = node.type == JSON_TAPE_ARRAY;
+                    std::string line = (open ? ICON_FA_CARET_DOWN " " : ICON_FA_CARET_RIGHT " ") +
+                                       name + (is_array ? "[" : "{") + std::to_string(node.size) +
+                                       (is_array ? "]" : "}");
+                    if (ImGui::Selectable(line.c_str())) {
+                        toggled = row.node;
+                    }
+                } break;
+                default: {
+                    std::string_view value = tape.text(text, node).substr(0, VALUE_MAX);
+                    ImGui::Text("%s%.*s", name.c_str(), static_cast<int>(value.size()),
+                                value.data());
+                } break;
+                }
+
+                if (ImGui::BeginPopupContextItem("##row")) {
+                    if (ImGui::MenuItem(ICON_FA_COPY " Copy")) {
+                        ImGui::SetClipboardText(tape.dump(text, row.node, row.depth).c_str());
+                    }
+                    ImGui::EndPopup();
+                }
+
+                ImGui::PopID();
+            }
+        }
+
+        // Rows are rebuilt after drawing so the clipper isn't disturbed
+        if (toggled.has_value()) {
+            state->toggle(toggled.value());
+        }
+    }
+    ImGui::EndChild();
+
+    ImGui::PopID();
+}
+
+// Expected body against the response, unchanged parts open when clicked
+void diff_view(const char* label, const BodyDiff* diff, DiffViewState* state,
+               ImVec2 size) noexcept {
+    assert(diff);
+    assert(state);
+
+    if (state->source != diff) {
+        *state = DiffViewState{.source = diff, .rows = diff->rows};
+    }
+
+    ImGui::PushID(label);
+
+    if (state->rows.empty() ||
+        (state->rows.size() == 1 && state->rows[0].op == DIFF_SKIP)) {
+        ImGui::Text("Bodies are the same");
+    }
+
+    if (ImGui::BeginChild("##diff", size, ImGuiChildFlags_FrameStyle,
+                          ImGuiWindowFlags_HorizontalScrollbar)) {
+        static const ImVec4 DELETE_COLOR = rgb_to_ImVec4(230, 90, 90, 255);
+        static const ImVec4 INSERT_COLOR = rgb_to_ImVec4(90, 200, 90, 255);
+
+        std::optional<size_t> expanded = std::nullopt;
+
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(state->rows.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                const DiffRow& row = state->rows.at(static_cast<size_t>(i));
+                ImGui::PushID(i);
+
+                switch (row.op) {
+                case DIFF_EQUAL: {
+                    std::string_view line =
+                        text_line(diff->response, diff->response_lines, row.b);
+                    ImGui::Text("%6zu %6zu   %.*s", row.a + 1, row.b + 1,
+                                static_cast<int>(line.size()), line.data());
+                } break;
+                case DIFF_DELETE: {
+                    std::string_view line =
+                        text_line(diff->expected, diff->expected_lines, row.a);
+                    ImGui::TextColored(DELETE_COLOR, "%6zu %6s - %.*s", row.a + 1, "",
+                                       static_cast<int>(line.size()), line.data());
+                } break;
+                case DIFF_INSERT: {
+                    std::string_view line =
+                        text_line(diff->response, diff->response_lines, row.b);
+                    ImGui::TextColored(INSERT_COLOR, "%6s %6zu + %.*s", "", row.b + 1,
+                                       static_cast<int>(line.size()), line.data());
+                } break;
+                case DIFF_SKIP: {
+                    std::string text = "... " + std::to_string(row.skipped) + " unchanged lines";
+                    if (ImGui::Selectable(text.c_str())) {
+                        expanded = static_cast<size_t>(i);
+                    }
+                } break;
+                }
+
+                ImGui::PopID();
+            }
+        }
+
+        // Rows change after drawing so the clipper isn't disturbed
+        if (expanded.has_value()) {
+            diff_expand(&state->rows, expanded.value());
+        }
+    }
+    ImGui::EndChild();
+
+    ImGui::PopID();
+}
+
 ModalResult open_result_details(AppState* app, TestResult* tr) noexcept {
     if (!ImGui::IsPopupOpen("Test Result Details")) {
         ImGui::OpenPopup("Test Result Details");
@@ -1312,12 +1611,27 @@ ModalResult open_result_details(AppState* app, TestResult* tr) noexcept {
                                 hint("Expected: %s", tr->original_test.response.status.c_str());
 
                                 {
-                                    // TODO: Add a diff like view (very very hard)
                                     ImGui::PushFont(app->mono_font);
-                                    // Is given readonly flag so const_cast is fine
-                                    ImGui::InputTextMultiline(
-                                        "##response_body", &const_cast<std::string&>(tr->res_body),
-                                        ImVec2(-1, 300), ImGuiInputTextFlags_ReadOnly);
+                                    const FormattedBody* body = test_result_body(app, tr);
+                                    if (body != nullptr && body->tape.has_value()) {
+                                        ImGui::Checkbox("Tree", &app->results.details_as_tree);
+                                    }
+
+                                    if (body != nullptr && body->tape.has_value() &&
+                                        app->results.details_as_tree) {
+                                        json_tree_view("##response_tree", body,
+                                                       body->tape.value(), body->text(),
+                                                       &app->results.details_tree,
+                                                       ImVec2(-1, 300));
+                                    } else if (body != nullptr) {
+                                        text_view("##response_body", body, body->text(),
+                                                  body->lines, &app->results.details_body,
+                                                  ImVec2(-1, 300));
+                                    } else {
+                                        ImSpinner::SpinnerIncDots("formatting", 5, 1);
+                                        ImGui::SameLine();
+                                        ImGui::Text("Formatting body");
+                                    }
 
                                     if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
                                         ResponseBodyType body_type =
@@ -1345,6 +1659,24 @@ ModalResult open_result_details(AppState* app, TestResult* tr) noexcept {
 
                                 ImGui::EndTabItem();
                             }
+
+                            const Response& expected = tr->original_test.response;
+                            if (expected.body_type != RESPONSE_ANY && !expected.body.empty() &&
+                                ImGui::BeginTabItem("Diff")) {
+                                ImGui::PushFont(app->mono_font);
+                                const BodyDiff* diff = test_result_diff(app, tr);
+                                if (diff != nullptr) {
+                                    diff_view("##response_diff", diff, &app->results.details_diff,
+                                              ImVec2(-1, 300));
+                                } else {
+                                    ImSpinner::SpinnerIncDots("comparing", 5, 1);
+                                    ImGui::SameLine();
+                                    ImGui::Text("Comparing bodies");
+                                }
+                                ImGui::PopFont();
+
+                                ImGui::EndTabItem();
+                            }
                             ImGui::EndTabBar();
                         }
                     }
@@ -1362,6 +1694,11 @@ ModalResult open_result_details(AppState* app, TestResult* tr) noexcept {
                 ImGui::InputText("##request_endpoint", &const_cast<std::string&>(tr->req_endpoint),
                                  ImGuiInputTextFlags_ReadOnly);
 
+                ImGui::Text("Request: ");
+                ImGui::SameLine();
+                ImGui::InputText("##request_line", &const_cast<std::string&>(tr->req_line),
+                                 ImGuiInputTextFlags_ReadOnly);
+
                 if (ImGui::BeginTabBar("request_details")) {
                     if (ImGui::BeginTabItem("Body")) {
                         {
@@ -1654,6 +1991,7 @@ void tabbed_editor(AppState* app) noexcept {
             case TAB_CHANGED:
                 tab.name = std::visit(LabelVisitor(), *original);
                 tab.just_opened = true; // to force refocus after
+                app->search.changed.insert(tab.original_idx);
                 app->undo_history.push_undo_history(app);
                 break;
             case TAB_NONE:
@@ -1670,8 +2008,9 @@ void tabbed_editor(AppState* app) noexcept {
     ImGui::PopFont();
 }
 
-void testing_result_row(AppState* app, size_t result_id,
-                        std::vector<TestResult>& results) noexcept {
+void testing_result_row(AppState* app, size_t row) noexcept {
+    TestResult& result = *results_row(app, row);
+
     auto deselect_all = [app]() {
         for (auto& [_, results] : app->test_results) {
             for (auto& result : results) {
@@ -1680,153 +2019,218 @@ void testing_result_row(AppState* app, size_t result_id,
         }
     };
 
-    auto shift_multiselect = [app, result_id](size_t result_idx) {
-        bool selection_start = false;
+    auto shift_multiselect = [app, row]() {
+        const std::vector<size_t>& visible = app->results.visible;
 
-        for (auto& [sel_result_id, sel_results] : app->test_results) {
-            for (size_t sel_result_idx = 0; sel_result_idx < sel_results.size(); sel_result_idx++) {
-                TestResult& sel_result = sel_results.at(sel_result_idx);
+        // Rows are in order so both ends are found with a binary search
+        auto [first, last] = std::minmax(app->results.last_selected_row, row);
+        size_t begin = std::lower_bound(visible.begin(), visible.end(), first) - visible.begin();
+        size_t end = std::upper_bound(visible.begin(), visible.end(), last) - visible.begin();
 
-                if (!(sel_result.status.load() == app->results.filter ||
-                      (sel_result.status.load() > app->results.filter &&
-                       app->results.filter_cumulative))) {
-                    continue;
-                }
-
-                sel_result.selected = selection_start;
-
-                if ((sel_result_id == app->results.last_selected_id &&
-                     sel_result_idx == app->results.last_selected_idx) ||
-                    (sel_result_id == result_id && sel_result_idx == result_idx)) {
-                    selection_start = !selection_start;
-                    sel_result.selected = true;
-                }
-            }
+        for (size_t pos = 0; pos < visible.size(); pos++) {
+            results_row(app, visible.at(pos))->selected = pos >= begin && pos < end;
         }
     };
 
-    ImGui::PushID(static_cast<int32_t>(result_id));
-    ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, {ImGui::GetStyle().FramePadding.x, 0});
-    for (size_t result_idx = 0; result_idx < results.size(); result_idx++) {
-        TestResult& result = results.at(result_idx);
-
-        if (!(result.status.load() == app->results.filter ||
-              (result.status.load() > app->results.filter && app->results.filter_cumulative))) {
-            continue;
-        }
+    ImGui::TableNextRow();
+    ImGui::PushID(static_cast<int32_t>(row));
+    // Test type and Name
+    if (ImGui::TableNextColumn()) {
+        http_type_button(result.original_test.type);
+        ImGui::SameLine();
 
-        ImGui::TableNextRow();
-        ImGui::PushID(static_cast<int32_t>(result_idx));
-        // Test type and Name
-        if (ImGui::TableNextColumn()) {
-            http_type_button(result.original_test.type);
-            ImGui::SameLine();
+        if (ImGui::Selectable(result.original_test.endpoint.c_str(), result.selected,
+                              SELECTABLE_FLAGS, ImVec2(0, 0))) {
+            if (ImGui::GetIO().MouseDoubleClicked[ImGuiMouseButton_Left]) {
+                result.open = true;
+                app->results.details = row;
+            }
+            auto& io = ImGui::GetIO();
+            if (io.KeyCtrl) {
+                result.selected = !result.selected;
+            } else if (io.KeyShift) {
+                shift_multiselect();
+            } else {
+                deselect_all();
+                result.selected = true;
+            }
 
-            if (ImGui::Selectable(result.original_test.endpoint.c_str(), result.selected,
-                                  SELECTABLE_FLAGS, ImVec2(0, 0))) {
-                if (ImGui::GetIO().MouseDoubleClicked[ImGuiMouseButton_Left]) {
-                    result.open = true;
-                }
-                auto& io = ImGui::GetIO();
-                if (io.KeyCtrl) {
-                    result.selected = !result.selected;
-                } else if (io.KeyShift) {
-                    shift_multiselect(result_idx);
-                } else {
-                    deselect_all();
-                    result.selected = true;
-                }
+            app->results.last_selected_row = row;
+        }
 
-                app->results.last_selected_id = result_id;
-                app->results.last_selected_idx = result_idx;
+        if (ImGui::BeginPopupContextItem("##testing_result_context")) {
+            if (!result.selected) {
+                deselect_all();
+                result.selected = true;
             }
 
-            if (ImGui::BeginPopupContextItem("##testing_result_context")) {
-                if (!result.selected) {
-                    deselect_all();
-                    result.selected = true;
+            // Only once instead of every frame the menu is open
+            if (ImGui::IsWindowAppearing()) {
+                app->results.any_running = false;
+                app->results.any_not_running = false;
+                for (auto& [_, results] : app->test_results) {
+                    for (auto& rt : results) {
+                        if (rt.selected) {
+                            app->results.any_running |= rt.running.load();
+                            app->results.any_not_running |= !rt.running.load();
+                        }
+                    }
                 }
+            }
 
-                if (ImGui::MenuItem(ICON_FA_NEWSPAPER " Details"
-                                                      "###details")) {
-                    result.open = true;
-                }
+            if (ImGui::MenuItem(ICON_FA_NEWSPAPER " Details"
+                                                  "###details")) {
+                result.open = true;
+                app->results.details = row;
+            }
 
-                if (ImGui::MenuItem(ICON_FA_ARROW_RIGHT " Goto original test"
-                                                        "###goto_original")) {
-                    if (app->tests.contains(result.original_test.id)) {
-                        app->editor_open_tab(result.original_test.id);
-                    } else {
-                        Log(LogLevel::Error, "Original test is missing");
-                    }
+            if (ImGui::MenuItem(ICON_FA_ARROW_RIGHT " Goto original test"
+                                                    "###goto_original")) {
+                if (app->tests.contains(result.original_test.id)) {
+                    app->editor_open_tab(result.original_test.id);
+                } else {
+                    Log(LogLevel::Error, "Original test is missing");
                 }
+            }
 
-                bool any_running = false;
-                bool any_not_running = false;
+            if (ImGui::MenuItem(ICON_FA_REDO " Rerun tests"
+                                             "###rerun_tests",
+                                nullptr, false, app->results.any_not_running)) {
                 for (auto& [_, results] : app->test_results) {
                     for (auto& rt : results) {
-                        if (rt.selected) {
-                            any_running |= rt.running.load();
-                            any_not_running |= !rt.running.load();
+                        if (rt.selected && !rt.running.load()) {
+                            rerun_test(app, &rt);
                         }
                     }
                 }
+            }
 
-                if (ImGui::MenuItem(ICON_FA_REDO " Rerun tests"
-                                                 "###rerun_tests",
-                                    nullptr, false, any_not_running)) {
-                    for (auto& [_, results] : app->test_results) {
-                        for (auto& rt : results) {
-                            if (rt.selected && !rt.running.load()) {
-                                rerun_test(app, &rt);
-                            }
+            if (ImGui::MenuItem(ICON_FA_STOP " Stop tests"
+                                             "###stop_tests",
+                                nullptr, false, app->results.any_running)) {
+                for (auto& [_, results] : app->test_results) {
+                    for (auto& rt : results) {
+                        if (rt.selected && rt.running.load()) {
+                            stop_test(app, &rt);
                         }
                     }
                 }
+            }
 
-                if (ImGui::MenuItem(ICON_FA_STOP " Stop tests"
-                                                 "###stop_tests",
-                                    nullptr, false, any_running)) {
-                    for (auto& [_, results] : app->test_results) {
-                        for (auto& rt : results) {
-                            if (rt.selected && rt.running.load()) {
-                                stop_test(&rt);
-                            }
-                        }
-                    }
-                }
+            ImGui::EndPopup();
+        }
+    }
 
-                ImGui::EndPopup();
-            }
+    // Status
+    if (ImGui::TableNextColumn()) {
+        ImGui::Text("%s", TestResultStatusLabels[result.status.load()]);
+    }
+
+    // Verdict
+    if (ImGui::TableNextColumn()) {
+        if (result.status.load() == STATUS_RUNNING) {
+            ImGui::ProgressBar(result.progress_total == 0
+                                   ? 0
+                                   : static_cast<float>(result.progress_current) /
+                                         result.progress_total);
+        } else {
+            ImGui::Text("%s", result.verdict.c_str());
         }
+    }
 
-        // Status
-        if (ImGui::TableNextColumn()) {
-            ImGui::Text("%s", TestResultStatusLabels[result.status.load()]);
+    ImGui::PopID();
+}
+
+// Single line part of text around the first match of query
+static std::string search_snippet(const std::string& text, const std::string& query) noexcept {
+    static constexpr size_t SNIPPET_CONTEXT = 32;
+
+    size_t pos = search_find(text, query);
+    if (pos == std::string::npos) {
+        pos = 0;
+    }
+
+    size_t start = pos > SNIPPET_CONTEXT ? pos - SNIPPET_CONTEXT : 0;
+    size_t end = std::min(text.size(), pos + query.size() + SNIPPET_CONTEXT);
+
+    std::string result = text.substr(start, end - start);
+    std::replace_if(
+        result.begin(), result.end(),
+        [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; }, ' ');
+    if (start > 0) {
+        result = "..." + result;
+    }
+    if (end < text.size()) {
+        result += "...";
+    }
+    return result;
+}
+
+void search_panel(AppState* app) noexcept {
+    ImGui::PushFont(app->regular_font);
+
+    SearchState& search = app->search;
+
+    ImGui::SetNextItemWidth(-1);
+    if (ImGui::InputTextWithHint("##search_query", ICON_FA_SEARCH " Search", &search.query)) {
+        search.matches_dirty = true;
+    }
+
+    for (size_t kind = 0; kind < ARRAY_SIZE(SearchFieldKindLabels); kind++) {
+        if (kind > 0) {
+            ImGui::SameLine();
         }
 
-        // Verdict
-        if (ImGui::TableNextColumn()) {
-            if (result.status.load() == STATUS_RUNNING) {
-                ImGui::ProgressBar(result.progress_total == 0
-                                       ? 0
-                                       : static_cast<float>(result.progress_current) /
-                                             result.progress_total);
-            } else {
-                ImGui::Text("%s", result.verdict.c_str());
-            }
+        bool enabled = search.kinds & (1 << kind);
+        if (ImGui::Checkbox(SearchFieldKindLabels[kind], &enabled)) {
+            search.kinds ^= static_cast<uint8_t>(1 << kind);
+            search.matches_dirty = true;
         }
+    }
 
-        ImGui::PopID();
+    search_matches_update(app);
+    ImGui::Text("%zu match(es)", search.matches.size());
+
+    if (ImGui::BeginTable("search", 3, TABLE_FLAGS)) {
+        ImGui::TableSetupColumn("Test");
+        ImGui::TableSetupColumn("Field", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Match");
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(search.matches.size()));
+        while (clipper.Step()) {
+            for (int pos = clipper.DisplayStart; pos < clipper.DisplayEnd; pos++) {
+                const SearchMatch& match = search.matches.at(static_cast<size_t>(pos));
+                assert(app->tests.contains(match.id));
+                const SearchField& field = search.index.documents.at(match.id).at(match.field);
+
+                ImGui::PushID(pos);
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+                std::string label = std::visit(LabelVisitor(), app->tests.at(match.id));
+                if (ImGui::Selectable(label.c_str(), false,
+                                      ImGuiSelectableFlags_SpanAllColumns |
+                                          ImGuiSelectableFlags_AllowDoubleClick) &&
+                    ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+                    app->editor_open_tab(match.id);
+                }
 
-        if (result.open) {
-            auto modal = open_result_details(app, &result);
-            result.open &= modal == MODAL_NONE;
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", SearchFieldKindLabels[field.kind]);
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", search_snippet(field.text, search.query).c_str());
+
+                ImGui::PopID();
+            }
         }
+
+        ImGui::EndTable();
     }
 
-    ImGui::PopStyleVar();
-    ImGui::PopID();
+    ImGui::PopFont();
 }
 
 void testing_results(AppState* app) noexcept {
@@ -1842,6 +2246,25 @@ void testing_results(AppState* app) noexcept {
     }
     ImGui::SameLine();
     ImGui::Checkbox("Cumulative", &app->results.filter_cumulative);
+    ImGui::SameLine();
+    // Words are matched by their start against response headers and bodies
+    ImGui::SetNextItemWidth(-1);
+    ImGui::InputTextWithHint("##results_query", ICON_FA_SEARCH " Search responses",
+                             &app->results.query);
+
+    // Summary of the whole run
+    {
+        const ResultCounters& counters = *app->run_counters;
+        for (size_t i = 0; i < ARRAY_SIZE(TestResultStatusLabels); i++) {
+            ImGui::Text("%s: %zu", TestResultStatusLabels[i],
+                        counters.count(static_cast<TestResultStatus>(i)));
+            ImGui::SameLine();
+        }
+        ImGui::Text("| %.1f/s", counters.throughput());
+    }
+
+    // Filter changes apply right away instead of next frame
+    results_update(app);
 
     if (ImGui::BeginTable("results", 3, TABLE_FLAGS)) {
         ImGui::TableSetupColumn("Test");
@@ -1849,13 +2272,37 @@ void testing_results(AppState* app) noexcept {
         ImGui::TableSetupColumn("Verdict");
         ImGui::TableHeadersRow();
 
-        for (auto& [result_id, results] : app->test_results) {
-            testing_result_row(app, result_id, results);
+        // Only visible rows are drawn
+        ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, {ImGui::GetStyle().FramePadding.x, 0});
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(app->results.visible.size()));
+        while (clipper.Step()) {
+            for (int pos = clipper.DisplayStart; pos < clipper.DisplayEnd; pos++) {
+                testing_result_row(app, app->results.visible.at(static_cast<size_t>(pos)));
+            }
         }
+        ImGui::PopStyleVar();
 
         ImGui::EndTable();
     }
 
+    // Outside of the table so it stays open while its row is scrolled away
+    if (app->results.details.has_value()) {
+        TestResult* result = results_row(app, app->results.details.value());
+        if (result->open) {
+            auto modal = open_result_details(app, result);
+            result->open &= modal == MODAL_NONE;
+        }
+
+        if (!result->open) {
+            app->results.details = std::nullopt;
+            // Views know what they show by address, it can be freed once they're closed
+            app->results.details_body = {};
+            app->results.details_tree = {};
+            app->results.details_diff = {};
+        }
+    }
+
     ImGui::PopFont();
 }
 
@@ -2138,13 +2585,16 @@ std::vector<HelloImGui::DockableWindow> windows(AppState* app) noexcept {
     auto tests_window = HelloImGui::DockableWindow("Tests###win_tests", "SideBarDockSpace",
                                                    [app]() { tree_view(app); });
 
+    auto search_window = HelloImGui::DockableWindow("Search###win_search", "SideBarDockSpace",
+                                                    [app]() { search_panel(app); });
+
     auto results_window = HelloImGui::DockableWindow("Results###win_results", "MainDockSpace",
                                                      [app]() { testing_results(app); });
 
     auto logs_window = HelloImGui::DockableWindow("Logs###win_logs", "LogDockSpace",
                                                   [app]() { HelloImGui::LogGui(); });
 
-    return {tests_window, tab_editor_window, results_window, logs_window};
+    return {tests_window, search_window, tab_editor_window, results_window, logs_window};
 }
 
 HelloImGui::DockingParams layout(AppState* app) noexcept {
@@ -2194,11 +2644,21 @@ void save_file_dialog(AppState* app) noexcept {
 }
 
 void open_file_dialog(AppState* app) noexcept {
-    auto open_file_dialog = pfd::open_file(
-        "Open File", ".", {"Weetee Files", "*.wt", "All Files", "*"}, pfd::opt::none);
+    auto open_file_dialog =
+        pfd::open_file("Open File", ".",
+                       {"Weetee Files", "*.wt", "Weetee Backups", "*.wtm", "All Files", "*"},
+                       pfd::opt::none);
 
     std::vector<std::string> result = open_file_dialog.result();
     if (result.size() > 0) {
+        if (std::filesystem::path(result[0]).extension() == ".wtm") {
+            // Backups are restored as a new file so saving doesn't overwrite the manifest
+            if (open_local_backup(app, result[0])) {
+                app->saved_file = {};
+            }
+            return;
+        }
+
         app->saved_file = LocalFile{result[0]};
         std::ifstream in(result[0]);
         app->open_file(in);
@@ -2289,6 +2749,14 @@ void show_menus(AppState* app) noexcept {
     }
     ImGui::PopStyleColor(1);
     end_transparent_button();
+
+    if (app->backup.running.load()) {
+        ImSpinner::SpinnerIncDots("backup", 5, 1);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Making a backup (%zu/%zu)", app->backup.progress_current.load(),
+                              app->backup.progress_total.load());
+        }
+    }
 }
 
 void show_app_menu_items(AppState* app) noexcept {}
@@ -2397,6 +2865,13 @@ void show_gui(AppState* app) noexcept {
 }
 
 void pre_frame(AppState* app) noexcept {
+    // Every frame so status events don't pile up while results are hidden
+    results_update(app);
+
+    // Full frame rate only while workers can change what's shown, otherwise frames are drawn on
+    // input and at the idle rate which also keeps the backup timer going
+    app->runner_params->fpsIdling.enableIdling = !app->is_busy();
+
     app->backup.time_since_last_backup += ImGui::GetIO().DeltaTime;
 
     if (app->backup.time_since_last_backup > app->conf.backup.time_to_backup) {
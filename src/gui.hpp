@@ -64,6 +64,8 @@ bool show_tree_view_row(AppState* app, Group& group, ImVec2& min_selectable_rect
                     ImVec2& max_selectable_rect, size_t idx = 0, float indentation = 0) noexcept;
 void tree_view(AppState* app) noexcept;
 
+void search_panel(AppState* app) noexcept;
+
 template <typename Data>
 bool partial_dict_row(AppState* app, PartialDict<Data>* pd, PartialDictElement<Data>* elem,
                       const VariablesMap& vars, int32_t flags, const char** hints,
@@ -157,6 +159,9 @@ bool partial_dict_row(AppState* app, PartialDict<Data>* pd, PartialDictElement<D
     }
 
     if (ImGui::TableNextColumn()) { // Name
+        // Keys are interned so they are edited through a copy
+        std::string key = elem->key;
+
         // If no key change is set, can use regular text input
         if (hint_count > 0 && !(flags & PARTIAL_DICT_NO_KEY_CHANGE)) {
             assert(hints);
@@ -164,11 +169,17 @@ bool partial_dict_row(AppState* app, PartialDict<Data>* pd, PartialDictElement<D
                 elem->cfs = ComboFilterState{};
             }
             ImGui::SetNextItemWidth(-1);
-            changed |= ComboFilter("##name", &elem->key, hints, hint_count, &elem->cfs.value());
+            if (ComboFilter("##name", &key, hints, hint_count, &elem->cfs.value())) {
+                elem->key = key;
+                changed = true;
+            }
         } else {
             ImGui::SetNextItemWidth(-1);
             ImGui::BeginDisabled(flags & PARTIAL_DICT_NO_KEY_CHANGE);
-            changed |= ImGui::InputText("##name", &elem->key);
+            if (ImGui::InputText("##name", &key)) {
+                elem->key = key;
+                changed = true;
+            }
             ImGui::EndDisabled();
         }
     }
@@ -278,6 +289,15 @@ bool editor_client_settings(const I18N* i18n, ClientSettings* set, bool show_dyn
 void show_httplib_headers(AppState* app, const httplib::Headers& headers) noexcept;
 void show_httplib_cookies(AppState* app, const httplib::Headers& headers) noexcept;
 
+// Read only text with find, source identifies the text so state is reset when it changes
+void text_view(const char* label, const void* source, std::string_view text,
+               const std::vector<size_t>& lines, TextViewState* state, ImVec2 size) noexcept;
+// Collapsible json, containers are only walked while they are open
+void json_tree_view(const char* label, const void* source, const JsonTape& tape,
+                    std::string_view text, JsonTreeState* state, ImVec2 size) noexcept;
+// Expected body against the response, unchanged parts open when clicked
+void diff_view(const char* label, const BodyDiff* diff, DiffViewState* state,
+               ImVec2 size) noexcept;
 ModalResult open_result_details(AppState* app, TestResult* tr) noexcept;
 
 enum EditorTabResult : uint8_t {
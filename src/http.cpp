@@ -68,3 +68,160 @@ ContentType parse_content_type(std::string input) noexcept {
 
     return {.type = type, .name = name};
 }
+
+bool glob_match(std::string_view pattern, std::string_view value) noexcept {
+    // Greedy with backtracking to the last star, linear for patterns without many stars
+    size_t p = 0, v = 0;
+    size_t star = std::string_view::npos, star_v = 0;
+
+    while (v < value.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            star_v = v;
+            continue;
+        }
+
+        if (p < pattern.size()) {
+            char c = pattern[p];
+            size_t width = 1;
+            if (c == '\\' && p + 1 < pattern.size()) {
+                c = pattern[p + 1];
+                width = 2;
+            } else if (c == '?') {
+                p++;
+                v++;
+                continue;
+            }
+
+            if (c == value[v]) {
+                p += width;
+                v++;
+                continue;
+            }
+        }
+
+        if (star == std::string_view::npos) {
+            return false;
+        }
+
+        // Star takes one more character
+        p = star + 1;
+        v = ++star_v;
+    }
+
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+bool HeaderPattern::match(const std::string& header_value) const noexcept {
+    switch (this->kind) {
+    case HEADER_CONTAINS:
+        return header_value.find(this->value) != std::string::npos;
+    case HEADER_GLOB:
+        return glob_match(this->value, header_value);
+    case HEADER_REGEX:
+        assert(this->regex.has_value());
+        return std::regex_search(header_value, this->regex.value());
+    }
+    return false;
+}
+
+static std::string lowercase(std::string str) noexcept {
+    std::for_each(str.begin(), str.end(),
+                  [](char& c) { c = static_cast<char>(std::tolower(c)); });
+    return str;
+}
+
+bool HeaderMatcher::add(const std::string& name, const std::string& value) noexcept {
+    HeaderPattern pattern = {
+        .kind = HeaderPattern::HEADER_CONTAINS,
+        .name = name,
+        .value = value,
+        .regex = std::nullopt,
+    };
+
+    if (value.starts_with(HEADER_REGEX_PREFIX)) {
+        pattern.kind = HeaderPattern::HEADER_REGEX;
+        try {
+            pattern.regex.emplace(value.substr(HEADER_REGEX_PREFIX.size()), std::regex::ECMAScript);
+        } catch (std::regex_error&) {
+            this->invalid = name;
+            return false;
+        }
+    } else if (value.starts_with(HEADER_GLOB_PREFIX)) {
+        pattern.kind = HeaderPattern::HEADER_GLOB;
+        pattern.value = value.substr(HEADER_GLOB_PREFIX.size());
+    } else {
+        // Escapes are accepted so values can be written the same way as in globs
+        find_and_replace(pattern.value, "\\*", "*");
+        find_and_replace(pattern.value, "\\?", "?");
+    }
+
+    this->names[lowercase(name)].push_back(this->patterns.size());
+    this->patterns.push_back(std::move(pattern));
+    return true;
+}
+
+const HeaderPattern* HeaderMatcher::match(const httplib::Headers& headers) const noexcept {
+    std::vector<bool> matched(this->patterns.size(), false);
+    size_t remaining = this->patterns.size();
+
+    for (const auto& [key, value] : headers) {
+        if (remaining == 0) {
+            break;
+        }
+
+        auto it = this->names.find(lowercase(key));
+        if (it == this->names.end()) {
+            continue;
+        }
+
+        for (size_t idx : it->second) {
+            if (!matched[idx] && this->patterns.at(idx).match(value)) {
+                matched[idx] = true;
+                remaining--;
+            }
+        }
+    }
+
+    for (size_t idx = 0; idx < this->patterns.size(); idx++) {
+        if (!matched[idx]) {
+            return &this->patterns.at(idx);
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const HeaderMatcher>
+HeaderMatcherCache::get(const httplib::Headers& expected) noexcept {
+    // Names can't contain a newline and values can't contain a null
+    std::string key;
+    for (const auto& [name, value] : expected) {
+        key += name + '\n' + value + '\0';
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->matchers.find(key);
+        if (it != this->matchers.end()) {
+            return it->second;
+        }
+    }
+
+    // Compiled outside of the lock, same headers being compiled twice at once is harmless
+    auto matcher = std::make_shared<HeaderMatcher>();
+    for (const auto& [name, value] : expected) {
+        if (!matcher->add(name, value)) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->matchers.size() >= max_size) {
+        this->matchers.clear();
+    }
+    this->matchers.try_emplace(key, matcher);
+    return matcher;
+}
@@ -4,6 +4,14 @@
 
 #include "algorithm"
 #include "cstdint"
+#include "memory"
+#include "mutex"
+#include "optional"
+#include "regex"
+#include "string"
+#include "string_view"
+#include "unordered_map"
+#include "vector"
 
 static const char* RequestHeadersLabels[] = {
     reinterpret_cast<const char*>("A-IM"),
@@ -218,3 +226,53 @@ std::string to_string(const ContentType& cont) noexcept;
 ContentType parse_content_type(std::string input) noexcept;
 
 bool status_match(const std::string& match, int status) noexcept;
+
+// Prefixes of expected header values that are globs or regexes
+constexpr std::string_view HEADER_GLOB_PREFIX = "glob:";
+constexpr std::string_view HEADER_REGEX_PREFIX = "regex:";
+
+// Expected header value
+//   regex:pattern is searched for in the value
+//   glob:pattern matches the whole value, * and ? are wildcards, \* and \? match them literally
+//   anything else has to be contained in the value, \* and \? are the same as * and ?
+struct HeaderPattern {
+    enum Kind : uint8_t {
+        HEADER_CONTAINS,
+        HEADER_GLOB,
+        HEADER_REGEX,
+    } kind;
+
+    std::string name;
+    std::string value;
+    std::optional<std::regex> regex;
+
+    bool match(const std::string& header_value) const noexcept;
+};
+
+bool glob_match(std::string_view pattern, std::string_view value) noexcept;
+
+// Expected headers compiled once and checked in a single pass over the response headers
+struct HeaderMatcher {
+    std::vector<HeaderPattern> patterns;
+    // Lowercase names to indices of their patterns
+    std::unordered_map<std::string, std::vector<size_t>> names;
+    // Name of the first header that failed to be added, empty when all of them were
+    std::string invalid = "";
+
+    // Returns false when value is an invalid regex
+    bool add(const std::string& name, const std::string& value) noexcept;
+
+    // Returns the first pattern no header matched, nullptr when all of them did
+    const HeaderPattern* match(const httplib::Headers& headers) const noexcept;
+};
+
+// Compiled matchers by their expected headers, safe to share between threads
+struct HeaderMatcherCache {
+    static constexpr size_t max_size = 64;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const HeaderMatcher>> matchers;
+
+    // Check HeaderMatcher::invalid before matching
+    std::shared_ptr<const HeaderMatcher> get(const httplib::Headers& expected) noexcept;
+};
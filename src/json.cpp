@@ -1,5 +1,10 @@
 #include "json.hpp"
 
+#include "algorithm"
+#include "cassert"
+#include "limits"
+#include "unordered_set"
+
 using json = nlohmann::json;
 
 const char* json_format(std::string& input) noexcept {
@@ -11,22 +16,525 @@ const char* json_format(std::string& input) noexcept {
     return nullptr;
 }
 
-const char* json_compare(const std::string& expected, const std::string& response) noexcept {
-    json json_expected, json_got;
+static const char* json_compare_sax(const json& expected, std::string_view response,
+                                    std::string* path, bool whole) noexcept;
 
-    json_expected = json::parse(expected, nullptr, false);
+const char* json_compare(const std::string& expected, const std::string& response) noexcept {
+    json json_expected = json::parse(expected, nullptr, false);
     if (json_expected.is_discarded()) {
         return "Invalid Expected JSON";
     }
 
-    json_got = json::parse(response, nullptr, false);
-    if (json_got.is_discarded()) {
-        return "Invalid Response JSON";
+    std::string path;
+    return json_compare_sax(json_expected, response, &path, true);
+}
+
+// Walks expected along with SAX events of the response
+struct JsonCompareSax {
+    using number_integer_t = json::number_integer_t;
+    using number_unsigned_t = json::number_unsigned_t;
+    using number_float_t = json::number_float_t;
+    using string_t = json::string_t;
+    using binary_t = json::binary_t;
+
+    struct Frame {
+        const json* expected;
+        // Current key of objects, index of arrays
+        std::string key;
+        size_t index;
+        std::unordered_set<const json*> seen;
+    };
+
+    const json* root;
+    // Open containers, frames past depth are kept so their sets don't allocate again
+    std::vector<Frame> frames = {};
+    size_t depth = 0;
+    const json* next = nullptr;
+
+    // Keeps parsing after a difference so invalid json is still noticed
+    bool whole = false;
+    bool invalid = false;
+    bool mismatch = false;
+    // A later value of a key replaces the earlier one, which the comparison can't undo
+    bool duplicate = false;
+    std::string path = "";
+
+    void set_mismatch() noexcept {
+        json::json_pointer pointer;
+        for (size_t i = 0; i < this->depth; i++) {
+            const Frame& frame = this->frames.at(i);
+            if (frame.expected->is_array()) {
+                pointer /= frame.index;
+            } else {
+                pointer /= frame.key;
+            }
+        }
+
+        this->mismatch = true;
+        this->path = pointer.to_string();
     }
 
-    if (json_expected != json_got) {
-        return "Unexpected Response JSON";
+    // Finds the expected value for the next element
+    bool element() noexcept {
+        if (this->depth == 0) {
+            this->next = this->root;
+            return true;
+        }
+
+        Frame& frame = this->frames.at(this->depth - 1);
+        if (frame.expected->is_array()) {
+            if (frame.index >= frame.expected->size()) {
+                this->set_mismatch();
+                return false;
+            }
+            this->next = &frame.expected->at(frame.index);
+        }
+        // Objects find it in key()
+        return true;
+    }
+
+    void advance() noexcept {
+        if (this->depth > 0 && this->frames.at(this->depth - 1).expected->is_array()) {
+            this->frames.at(this->depth - 1).index++;
+        }
+    }
+
+    bool scalar(const json& value) noexcept {
+        if (this->mismatch) {
+            return true;
+        }
+        if (!this->element()) {
+            return this->whole;
+        }
+        if (*this->next != value) {
+            this->set_mismatch();
+            return this->whole;
+        }
+        this->advance();
+        return true;
+    }
+
+    bool begin(json::value_t type) noexcept {
+        if (this->mismatch) {
+            return true;
+        }
+        if (!this->element()) {
+            return this->whole;
+        }
+        if (this->next->type() != type) {
+            this->set_mismatch();
+            return this->whole;
+        }
+
+        if (this->depth == this->frames.size()) {
+            this->frames.emplace_back();
+        }
+        Frame& frame = this->frames.at(this->depth++);
+        frame.expected = this->next;
+        frame.key.clear();
+        frame.index = 0;
+        frame.seen.clear();
+        return true;
+    }
+
+    bool end() noexcept {
+        if (this->mismatch) {
+            return true;
+        }
+        Frame& frame = this->frames.at(this->depth - 1);
+        if (frame.expected->is_array()) {
+            if (frame.index != frame.expected->size()) {
+                this->set_mismatch();
+                return this->whole;
+            }
+        } else if (frame.seen.size() != frame.expected->size()) {
+            // Report the first missing key
+            for (const auto& [key, value] : frame.expected->items()) {
+                if (!frame.seen.contains(&value)) {
+                    frame.key = key;
+                    this->set_mismatch();
+                    return this->whole;
+                }
+            }
+        }
+
+        this->depth--;
+        this->advance();
+        return true;
+    }
+
+    bool null() noexcept { return this->scalar(nullptr); }
+    bool boolean(bool val) noexcept { return this->scalar(val); }
+    bool number_integer(number_integer_t val) noexcept { return this->scalar(val); }
+    bool number_unsigned(number_unsigned_t val) noexcept { return this->scalar(val); }
+    bool number_float(number_float_t val, const string_t&) noexcept { return this->scalar(val); }
+    bool binary(binary_t& val) noexcept { return this->scalar(json::binary(std::move(val))); }
+
+    bool string(string_t& val) noexcept {
+        if (this->mismatch) {
+            return true;
+        }
+        if (!this->element()) {
+            return this->whole;
+        }
+        // Compared in place so long strings aren't copied
+        if (!this->next->is_string() || this->next->get_ref<const string_t&>() != val) {
+            this->set_mismatch();
+            return this->whole;
+        }
+        this->advance();
+        return true;
+    }
+
+    bool start_object(size_t) noexcept { return this->begin(json::value_t::object); }
+    bool end_object() noexcept { return this->end(); }
+    bool start_array(size_t) noexcept { return this->begin(json::value_t::array); }
+    bool end_array() noexcept { return this->end(); }
+
+    bool key(string_t& val) noexcept {
+        if (this->mismatch) {
+            return true;
+        }
+        Frame& frame = this->frames.at(this->depth - 1);
+        frame.key = std::move(val);
+
+        auto it = frame.expected->find(frame.key);
+        if (it == frame.expected->end()) {
+            this->set_mismatch();
+            return this->whole;
+        }
+        // Duplicate keys are compared again, the last one has to match
+        if (!frame.seen.insert(&it.value()).second) {
+            this->duplicate = true;
+        }
+
+        this->next = &it.value();
+        return true;
     }
 
+    bool parse_error(size_t, const std::string&, const json::exception&) noexcept {
+        this->invalid = true;
+        return false;
+    }
+};
+
+static const char* json_compare_sax(const json& expected, std::string_view response,
+                                    std::string* path, bool whole) noexcept {
+    assert(path);
+
+    JsonCompareSax sax = {.root = &expected, .whole = whole};
+    bool equal = json::sax_parse(response, &sax);
+    *path = std::move(sax.path);
+
+    if (sax.invalid) {
+        return "Invalid Response JSON";
+    }
+    if (!equal || sax.mismatch) {
+        // Difference might be in a value that a duplicate key replaced, parsed documents keep
+        // the last value of a key
+        if (sax.duplicate) {
+            json parsed = json::parse(response, nullptr, false);
+            if (!parsed.is_discarded() && parsed == expected) {
+                path->clear();
+                return nullptr;
+            }
+        }
+        return "Unexpected Response JSON";
+    }
     return nullptr;
 }
+
+const char* json_compare(const json& expected, std::string_view response,
+                         std::string* path) noexcept {
+    return json_compare_sax(expected, response, path, false);
+}
+
+// Appends every SAX event as a node
+struct JsonTapeSax {
+    using number_integer_t = json::number_integer_t;
+    using number_unsigned_t = json::number_unsigned_t;
+    using number_float_t = json::number_float_t;
+    using string_t = json::string_t;
+    using binary_t = json::binary_t;
+
+    JsonTape* tape;
+    std::string* out;
+    // Open containers
+    std::vector<uint32_t> stack = {};
+    // Key of the next node
+    uint32_t pending_key = 0;
+    uint32_t pending_key_size = 0;
+    bool after_key = false;
+
+    void newline(size_t depth) noexcept {
+        this->out->push_back('\n');
+        this->out->append(depth * JsonTape::indent, ' ');
+    }
+
+    // Separator and indentation before an element, values after their key have it already
+    void element() noexcept {
+        if (this->after_key) {
+            this->after_key = false;
+            return;
+        }
+
+        if (!this->stack.empty()) {
+            if (this->tape->nodes.at(this->stack.back()).size > 0) {
+                this->out->push_back(',');
+            }
+            this->newline(this->stack.size());
+        }
+    }
+
+    bool node(JsonTapeType type, std::string_view text) noexcept {
+        this->element();
+        auto offset = static_cast<uint32_t>(this->out->size());
+        this->out->append(text);
+
+        auto idx = static_cast<uint32_t>(this->tape->nodes.size());
+        this->tape->nodes.push_back({
+            .key = this->pending_key,
+            .key_size = this->pending_key_size,
+            .text = offset,
+            .text_size = static_cast<uint32_t>(text.size()),
+            .end = idx + 1,
+            .size = 0,
+            .type = type,
+        });
+        this->pending_key = 0;
+        this->pending_key_size = 0;
+
+        if (!this->stack.empty()) {
+            this->tape->nodes.at(this->stack.back()).size++;
+        }
+        if (type == JSON_TAPE_ARRAY || type == JSON_TAPE_OBJECT) {
+            this->stack.push_back(idx);
+        }
+        return true;
+    }
+
+    bool end(char close) noexcept {
+        JsonTapeNode& container = this->tape->nodes.at(this->stack.back());
+        this->stack.pop_back();
+
+        if (container.size > 0) {
+            this->newline(this->stack.size());
+        }
+        this->out->push_back(close);
+        container.text_size = static_cast<uint32_t>(this->out->size() - container.text);
+        container.end = static_cast<uint32_t>(this->tape->nodes.size());
+        return true;
+    }
+
+    bool null() noexcept { return this->node(JSON_TAPE_NULL, "null"); }
+    bool boolean(bool val) noexcept {
+        return this->node(JSON_TAPE_BOOLEAN, val ? "true" : "false");
+    }
+    bool number_integer(number_integer_t val) noexcept {
+        return this->node(JSON_TAPE_NUMBER, std::to_string(val));
+    }
+    bool number_unsigned(number_unsigned_t val) noexcept {
+        return this->node(JSON_TAPE_NUMBER, std::to_string(val));
+    }
+    bool number_float(number_float_t, const string_t& val) noexcept {
+        return this->node(JSON_TAPE_NUMBER, val);
+    }
+    bool binary(binary_t&) noexcept { return this->node(JSON_TAPE_NULL, "null"); }
+    // Escaped the same way as dump, the parser already rejected invalid UTF-8
+    bool string(string_t& val) noexcept {
+        return this->node(JSON_TAPE_STRING, json(std::move(val)).dump());
+    }
+
+    bool start_object(size_t) noexcept { return this->node(JSON_TAPE_OBJECT, "{"); }
+    bool end_object() noexcept { return this->end('}'); }
+    bool start_array(size_t) noexcept { return this->node(JSON_TAPE_ARRAY, "["); }
+    bool end_array() noexcept { return this->end(']'); }
+
+    bool key(string_t& val) noexcept {
+        this->element();
+        std::string quoted = json(std::move(val)).dump();
+        this->pending_key = static_cast<uint32_t>(this->out->size() + 1);
+        this->pending_key_size = static_cast<uint32_t>(quoted.size() - 2);
+        this->out->append(quoted);
+        this->out->append(": ");
+        this->after_key = true;
+        return true;
+    }
+
+    bool parse_error(size_t, const std::string&, const json::exception&) noexcept {
+        return false;
+    }
+};
+
+bool JsonTape::parse(std::string_view json_text, std::string* formatted) noexcept {
+    assert(formatted);
+
+    this->nodes.clear();
+    formatted->clear();
+
+    JsonTapeSax sax = {.tape = this, .out = formatted};
+    if (!json::sax_parse(json_text, &sax) ||
+        formatted->size() > std::numeric_limits<uint32_t>::max()) {
+        this->nodes.clear();
+        formatted->clear();
+        return false;
+    }
+
+    this->nodes.shrink_to_fit();
+    return true;
+}
+
+std::string JsonTape::dump(std::string_view formatted, size_t node, size_t depth) const noexcept {
+    std::string_view text = this->text(formatted, this->nodes.at(node));
+    std::string result;
+    result.reserve(text.size());
+
+    // Strings never contain raw newlines so every one of them is followed by indentation
+    size_t shift = depth * JsonTape::indent;
+    size_t start = 0;
+    for (size_t pos = text.find('\n'); pos != std::string_view::npos;
+         pos = text.find('\n', start)) {
+        result.append(text.substr(start, pos + 1 - start));
+        start = std::min(pos + 1 + shift, text.size());
+    }
+    result.append(text.substr(start));
+    return result;
+}
+
+void JsonTreeState::toggle(size_t node) noexcept {
+    if (!this->open.erase(node)) {
+        this->open.insert(node);
+    }
+    this->dirty = true;
+}
+
+static void json_tree_rows(const JsonTape& tape, const JsonTreeState& state, JsonTreeRow row,
+                           std::vector<JsonTreeRow>* rows) noexcept {
+    assert(rows);
+
+    size_t node = row.node;
+    rows->push_back(row);
+    if (!state.open.contains(node)) {
+        return;
+    }
+
+    const JsonTapeNode& parent = tape.nodes.at(node);
+    JsonTreeRow child = {.node = node + 1, .depth = row.depth + 1, .parent = node, .index = 0};
+    for (; child.node < parent.end; child.node = tape.nodes.at(child.node).end) {
+        json_tree_rows(tape, state, child, rows);
+        child.index++;
+    }
+}
+
+void JsonTreeState::update(const JsonTape& tape) noexcept {
+    if (!this->dirty) {
+        return;
+    }
+    this->dirty = false;
+
+    this->rows.clear();
+    if (!tape.nodes.empty()) {
+        json_tree_rows(tape, *this, {.node = 0, .depth = 0, .parent = -1ull, .index = 0},
+                       &this->rows);
+    }
+}
+
+std::shared_ptr<const json> JsonCache::get(const std::string& text) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->documents.find(text);
+        if (it != this->documents.end()) {
+            return it->second;
+        }
+    }
+
+    // Parsed outside of the lock, same text being parsed twice at once is harmless
+    std::shared_ptr<const json> document;
+    json parsed = json::parse(text, nullptr, false);
+    if (!parsed.is_discarded()) {
+        document = std::make_shared<const json>(std::move(parsed));
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->documents.size() >= max_size) {
+        this->documents.clear();
+    }
+    this->documents.try_emplace(text, document);
+    return document;
+}
+
+void JsonWriter::newline(size_t depth) noexcept {
+    *this->os << '\n' << std::string(depth * this->indent, ' ');
+}
+
+void JsonWriter::element() noexcept {
+    if (this->after_key) {
+        this->after_key = false;
+        return;
+    }
+
+    if (!this->counts.empty()) {
+        if (this->counts.back()++ > 0) {
+            *this->os << ',';
+        }
+        this->newline(this->counts.size());
+    }
+}
+
+void JsonWriter::end(char close) noexcept {
+    assert(!this->counts.empty());
+
+    size_t count = this->counts.back();
+    this->counts.pop_back();
+    if (count > 0) {
+        this->newline(this->counts.size());
+    }
+    *this->os << close;
+}
+
+void JsonWriter::begin_object() noexcept {
+    assert(this->os);
+
+    this->element();
+    *this->os << '{';
+    this->counts.push_back(0);
+}
+
+void JsonWriter::end_object() noexcept { this->end('}'); }
+
+void JsonWriter::begin_array() noexcept {
+    assert(this->os);
+
+    this->element();
+    *this->os << '[';
+    this->counts.push_back(0);
+}
+
+void JsonWriter::end_array() noexcept { this->end(']'); }
+
+void JsonWriter::key(const std::string& key) {
+    assert(this->os);
+    assert(!this->after_key);
+
+    this->element();
+    *this->os << json(key).dump() << ": ";
+    this->after_key = true;
+}
+
+void JsonWriter::value(const json& value) {
+    assert(this->os);
+
+    this->element();
+
+    // Nested lines are shifted to the current depth, strings never contain raw newlines
+    std::string dumped = value.dump(this->indent);
+    std::string prefix = "\n" + std::string(this->counts.size() * this->indent, ' ');
+    size_t start = 0;
+    for (size_t pos = dumped.find('\n'); pos != std::string::npos;
+         pos = dumped.find('\n', start)) {
+        this->os->write(dumped.data() + start, static_cast<std::streamsize>(pos - start));
+        *this->os << prefix;
+        start = pos + 1;
+    }
+    this->os->write(dumped.data() + start, static_cast<std::streamsize>(dumped.size() - start));
+}
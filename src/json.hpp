@@ -5,12 +5,132 @@
 #include "i18n.hpp"
 #include "utils.hpp"
 
+#include "memory"
+#include "mutex"
+#include "ostream"
 #include "string"
+#include "string_view"
+#include "unordered_map"
+#include "unordered_set"
 #include "variant"
+#include "vector"
 
 // returns an error message, if there isn't returns null pointer
 const char* json_format(std::string& json) noexcept;
 const char* json_compare(const std::string& expected, const std::string& response) noexcept;
+// Parses response while comparing it to expected and stops at the first difference
+// path is set to the JSON pointer of the difference, response invalid after it isn't noticed
+// Duplicate keys keep their last value, a difference after a duplicate is confirmed on the parsed
+// response, one before it is reported as is
+const char* json_compare(const nlohmann::json& expected, std::string_view response,
+                         std::string* path) noexcept;
+
+// Parsed documents by their text, safe to share between threads
+struct JsonCache {
+    static constexpr size_t max_size = 64;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const nlohmann::json>> documents;
+
+    // Returns nullptr when text is invalid
+    std::shared_ptr<const nlohmann::json> get(const std::string& text) noexcept;
+};
+
+// Writes json to a stream while it's produced instead of building it whole
+// Output is the same as json::dump(indent) would give for the same keys in the same order
+struct JsonWriter {
+    std::ostream* os;
+    size_t indent = 4;
+
+    // Amount of elements in every open container
+    std::vector<size_t> counts = {};
+    bool after_key = false;
+
+    void begin_object() noexcept;
+    void end_object() noexcept;
+    void begin_array() noexcept;
+    void end_array() noexcept;
+
+    // Must be followed by a value or a container
+    // Both throw json::type_error on invalid UTF-8 same as dump
+    void key(const std::string& key);
+    void value(const nlohmann::json& value);
+
+  private:
+    void element() noexcept;
+    void end(char close) noexcept;
+    void newline(size_t depth) noexcept;
+};
+
+enum JsonTapeType : uint8_t {
+    JSON_TAPE_NULL,
+    JSON_TAPE_BOOLEAN,
+    JSON_TAPE_NUMBER,
+    JSON_TAPE_STRING,
+    JSON_TAPE_ARRAY,
+    JSON_TAPE_OBJECT,
+};
+
+// Value of a parsed document, children directly follow their container
+// Offsets are 32 bit to keep nodes small since there's one for every value
+struct JsonTapeNode {
+    // Offsets into the formatted text, key is empty outside of objects and stays escaped
+    uint32_t key;
+    uint32_t key_size;
+    // Whole value as formatted, strings are quoted and escaped
+    uint32_t text;
+    uint32_t text_size;
+    // Index after the subtree, the next sibling when there is one
+    uint32_t end;
+    // Amount of elements in containers
+    uint32_t size;
+    JsonTapeType type;
+};
+
+// Flat parsed document that takes a fraction of the memory of a json DOM
+// Nodes point into the text made when parsing instead of keeping their own strings
+struct JsonTape {
+    static constexpr size_t indent = 4;
+
+    std::vector<JsonTapeNode> nodes = {};
+
+    std::string_view key(std::string_view formatted, const JsonTapeNode& node) const noexcept {
+        return formatted.substr(node.key, node.key_size);
+    }
+    std::string_view text(std::string_view formatted, const JsonTapeNode& node) const noexcept {
+        return formatted.substr(node.text, node.text_size);
+    }
+
+    // Returns false when json is invalid or formatted is over 4GB
+    // formatted is the same as json::dump(indent) but keys keep their order and numbers are
+    // kept as written
+    bool parse(std::string_view json, std::string* formatted) noexcept;
+    // Text of a node without the indentation of its depth
+    std::string dump(std::string_view formatted, size_t node, size_t depth) const noexcept;
+};
+
+struct JsonTreeRow {
+    size_t node;
+    size_t depth;
+    // -1ull for the root
+    size_t parent;
+    // Position in the parent
+    size_t index;
+};
+
+// Opened containers of a tape and the rows they make visible
+struct JsonTreeState {
+    // Tape the state belongs to, the state is reset when another tape is shown
+    const void* source = nullptr;
+
+    std::unordered_set<size_t> open = {0};
+    std::vector<JsonTreeRow> rows = {};
+    bool dirty = true;
+
+    void toggle(size_t node) noexcept;
+    // Rebuilds rows when dirty, closed containers are skipped whole
+    void update(const JsonTape& tape) noexcept;
+};
 
 // This doesn't work on windows...
 namespace nlohmann {
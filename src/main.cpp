@@ -39,7 +39,9 @@ int main(int argc, char** argv) {
     runner_params.callbacks.RegisterTests = [&app]() { register_tests(&app); };
 
     runner_params.dockingParams = layout(&app);
-    runner_params.fpsIdling.enableIdling = false;
+    // Toggled every frame by pre_frame, off while tests or requests are running
+    runner_params.fpsIdling.enableIdling = true;
+    runner_params.fpsIdling.fpsIdle = 4.0f;
     runner_params.useImGuiTestEngine = true;
 
     runner_params.iniFilename = "weetee" FS_SLASH "imgui.ini";
@@ -23,42 +23,15 @@ template <typename Data> struct PartialDictElement {
     uint8_t flags = PARTIAL_DICT_ELEM_ENABLED;
 
     // save
-    std::string key;
+    InternedString key;
     Data data;
 
     // do not save
     std::optional<ComboFilterState> cfs; // If hints are given
 
-    void save(SaveState* save) const noexcept {
-        assert(save);
-
-        save->save(this->flags);
-        save->save(this->key);
-        save->save(this->data);
-    }
-
-    bool can_load(SaveState* save) const noexcept {
-        assert(save);
-
-        if (!save->can_load(this->flags)) {
-            return false;
-        }
-        if (!save->can_load(this->key)) {
-            return false;
-        }
-        if (!save->can_load(this->data)) {
-            return false;
-        }
-
-        return true;
-    }
-
-    void load(SaveState* save) noexcept {
-        assert(save);
-
-        save->load(this->flags);
-        save->load(this->key);
-        save->load(this->data);
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&PartialDictElement::flags, &PartialDictElement::key,
+                               &PartialDictElement::data);
     }
 
     bool operator!=(const PartialDictElement<Data>& other) const noexcept {
@@ -80,19 +53,8 @@ template <typename Data> struct PartialDict {
         return this->elements == other.elements;
     }
 
-    void save(SaveState* save) const noexcept {
-        assert(save);
-        save->save(this->elements);
-    }
-
-    bool can_load(SaveState* save) const noexcept {
-        assert(save);
-        return save->can_load(this->elements);
-    }
-
-    void load(SaveState* save) noexcept {
-        assert(save);
-        return save->load(this->elements);
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&PartialDict::elements);
     }
 
     constexpr bool empty() const noexcept { return this->elements.empty(); }
@@ -127,9 +89,10 @@ struct MultiPartBodyElementData {
 
     bool operator==(const MultiPartBodyElementData& other) const noexcept;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&MultiPartBodyElementData::type, &MultiPartBodyElementData::data,
+                               &MultiPartBodyElementData::content_type);
+    }
 
     void resolve_content_type() noexcept;
 };
@@ -145,9 +108,9 @@ struct CookiesElementData {
 
     bool operator!=(const CookiesElementData& other) const noexcept;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&CookiesElementData::data);
+    }
 };
 using Cookies = PartialDict<CookiesElementData>;
 using CookiesElement = Cookies::ElementType;
@@ -161,9 +124,9 @@ struct ParametersElementData {
 
     bool operator!=(const ParametersElementData& other) const noexcept;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&ParametersElementData::data);
+    }
 };
 using Parameters = PartialDict<ParametersElementData>;
 using ParametersElement = Parameters::ElementType;
@@ -176,9 +139,9 @@ struct HeadersElementData {
 
     bool operator!=(const HeadersElementData& other) const noexcept;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&HeadersElementData::data);
+    }
 };
 using Headers = PartialDict<HeadersElementData>;
 using HeadersElement = Headers::ElementType;
@@ -192,9 +155,9 @@ struct VariablesElementData {
 
     bool operator!=(const VariablesElementData& other) const noexcept;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&VariablesElementData::data, &VariablesElementData::separator);
+    }
 };
 
 using Variables = PartialDict<VariablesElementData>;
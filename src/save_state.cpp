@@ -42,47 +42,267 @@ void SaveState::load(std::string& str) noexcept {
     return;
 }
 
+void SaveState::save(const InternedString& str) noexcept {
+    auto [it, inserted] = this->string_ids.try_emplace(str.ptr.get(), this->strings.size());
+    if (inserted) {
+        this->strings.push_back(str);
+    }
+
+    this->save(it->second);
+}
+
+bool SaveState::can_load(const InternedString& str) noexcept {
+    if (this->save_version < 4) {
+        // Older versions saved them as regular strings
+        return this->can_load(str.str());
+    }
+
+    size_t id = 0;
+    if (!this->can_load_reset(id)) {
+        return false;
+    }
+    this->load(id);
+
+    return id < this->strings.size();
+}
+
+void SaveState::load(InternedString& str) noexcept {
+    if (this->save_version < 4) {
+        std::string value;
+        this->load(value);
+        str = value;
+        return;
+    }
+
+    size_t id;
+    this->load(id);
+
+    assert(id < this->strings.size());
+    str = this->strings[id];
+}
+
+void SaveState::save_interned(const std::string& str) noexcept { this->save(InternedString(str)); }
+
+bool SaveState::can_load_interned(const std::string&) noexcept {
+    return this->can_load(InternedString());
+}
+
+void SaveState::load_interned(std::string& str) noexcept {
+    InternedString interned;
+    this->load(interned);
+    str = interned.str();
+}
+
+static size_t endpoint_host_length(const std::string& endpoint) noexcept {
+    size_t scheme = endpoint.find("://");
+    size_t slash = endpoint.find('/', scheme == std::string::npos ? 0 : scheme + 3);
+    return slash == std::string::npos ? endpoint.length() : slash;
+}
+
+void SaveState::save_endpoint(const std::string& endpoint) noexcept {
+    size_t host_length = endpoint_host_length(endpoint);
+    this->save(InternedString(std::string_view(endpoint).substr(0, host_length)));
+    this->save(InternedString(std::string_view(endpoint).substr(host_length)));
+}
+
+bool SaveState::can_load_endpoint(const std::string& endpoint) noexcept {
+    if (this->save_version < 4) {
+        return this->can_load(endpoint);
+    }
+
+    return this->can_load(InternedString()) && this->can_load(InternedString());
+}
+
+void SaveState::load_endpoint(std::string& endpoint) noexcept {
+    if (this->save_version < 4) {
+        this->load(endpoint);
+        return;
+    }
+
+    InternedString host, path;
+    this->load(host);
+    this->load(path);
+    endpoint = host.str() + path.str();
+}
+
 void SaveState::finish_save() noexcept {
     this->original_size = this->original_buffer.size();
     this->original_buffer.shrink_to_fit();
+    this->string_ids.clear();
 }
 
 void SaveState::reset_load() noexcept { this->load_idx = 0; }
 
+static void write_size(std::ostream& os, size_t size) noexcept {
+    os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+}
+
+static bool read_size(std::istream& is, size_t* size) noexcept {
+    assert(size);
+    is.read(reinterpret_cast<char*>(size), sizeof(*size));
+    return is && is.gcount() == sizeof(*size);
+}
+
+// Reads in pieces so a corrupted size fails on end of file instead of allocating all of it
+static bool read_exact(std::istream& is, std::vector<char>* buffer, size_t size) noexcept {
+    assert(buffer);
+
+    while (size > 0) {
+        size_t piece = std::min(size, SAVE_STATE_CHUNK_SIZE);
+        size_t offset = buffer->size();
+        buffer->resize(offset + piece);
+
+        is.read(buffer->data() + offset, static_cast<std::streamsize>(piece));
+        if (!is || static_cast<size_t>(is.gcount()) != piece) {
+            return false;
+        }
+
+        size -= piece;
+    }
+
+    return true;
+}
+
+static void write_strings(std::ostream& os, const std::vector<InternedString>& strings) noexcept {
+    write_size(os, strings.size());
+    for (const auto& str : strings) {
+        write_size(os, str.length());
+        os.write(str.c_str(), static_cast<std::streamsize>(str.length()));
+    }
+}
+
+static bool read_strings(std::istream& is, std::vector<InternedString>* strings) noexcept {
+    assert(strings);
+
+    size_t count;
+    if (!read_size(is, &count) || count > SAVE_STATE_MAX_SIZE) {
+        return false;
+    }
+
+    std::vector<char> buffer;
+    strings->clear();
+    strings->reserve(std::min(count, SAVE_STATE_CHUNK_SIZE));
+    for (size_t i = 0; i < count; i++) {
+        size_t length;
+        if (!read_size(is, &length)) {
+            return false;
+        }
+
+        buffer.clear();
+        if (!read_exact(is, &buffer, length)) {
+            return false;
+        }
+        strings->emplace_back(std::string_view(buffer.data(), buffer.size()));
+    }
+
+    return true;
+}
+
+bool SaveState::begin_stream(std::ostream* os) noexcept {
+    assert(os);
+
+    this->stream = os;
+    this->original_size = 0;
+    this->original_buffer.clear();
+    this->strings.clear();
+    this->string_ids.clear();
+
+    write_size(*this->stream, this->save_version);
+    return static_cast<bool>(*this->stream);
+}
+
+void SaveState::write_chunk(const char* ptr, size_t size) noexcept {
+    assert(this->stream);
+    assert(ptr);
+    assert(size > 0);
+
+    write_size(*this->stream, size);
+    this->stream->write(ptr, static_cast<std::streamsize>(size));
+    this->original_size += size;
+}
+
+void SaveState::flush_stream() noexcept {
+    assert(this->stream);
+
+    if (this->original_buffer.empty()) {
+        return;
+    }
+
+    this->write_chunk(this->original_buffer.data(), this->original_buffer.size());
+    this->original_buffer.clear();
+}
+
+bool SaveState::finish_stream() noexcept {
+    assert(this->stream);
+
+    this->flush_stream();
+    write_size(*this->stream, 0);
+    write_strings(*this->stream, this->strings);
+    this->stream->flush();
+    this->string_ids.clear();
+
+    bool result = static_cast<bool>(*this->stream);
+    this->stream = nullptr;
+    this->original_buffer.shrink_to_fit();
+    return result;
+}
+
 bool SaveState::write(std::ostream& os) const noexcept {
     assert(os);
     assert(this->original_size > 0);
     assert(this->original_buffer.size() == this->original_size);
+    // Buffers loaded from older versions have a different layout
+    assert(this->save_version == SAVE_STATE_VERSION);
 
-    if (this->original_size > SAVE_STATE_MAX_SIZE) {
-        return false;
+    write_size(os, SAVE_STATE_VERSION);
+    for (size_t offset = 0; offset < this->original_size; offset += SAVE_STATE_CHUNK_SIZE) {
+        size_t size = std::min(SAVE_STATE_CHUNK_SIZE, this->original_size - offset);
+        write_size(os, size);
+        os.write(this->original_buffer.data() + offset, static_cast<std::streamsize>(size));
     }
-
-    os.write(reinterpret_cast<const char*>(&this->save_version), sizeof(this->save_version));
-    os.write(reinterpret_cast<const char*>(&this->original_size), sizeof(this->original_size));
-    os.write(this->original_buffer.data(), static_cast<int32_t>(this->original_buffer.size()));
+    write_size(os, 0);
+    write_strings(os, this->strings);
     os.flush();
 
-    return true;
+    return static_cast<bool>(os);
 }
 
 bool SaveState::read(std::istream& is) noexcept {
     assert(is);
-    is.read(reinterpret_cast<char*>(&this->save_version), sizeof(this->save_version));
-    if (!is || is.eof()) {
-        return false;
-    }
-    is.read(reinterpret_cast<char*>(&this->original_size), sizeof(this->original_size));
 
-    assert(this->original_size > 0);
-    if (!is || is.eof() || this->original_size > SAVE_STATE_MAX_SIZE) {
+    this->original_buffer.clear();
+    this->original_size = 0;
+    this->load_idx = 0;
+    this->strings.clear();
+
+    if (!read_size(is, &this->save_version) || this->save_version > SAVE_STATE_VERSION) {
         return false;
     }
 
-    this->original_buffer.reserve(this->original_size);
-    this->original_buffer.resize(this->original_size);
+    if (this->save_version < 3) {
+        size_t size;
+        if (!read_size(is, &size) || size == 0 || !read_exact(is, &this->original_buffer, size)) {
+            return false;
+        }
+    } else {
+        size_t size;
+        while (true) {
+            if (!read_size(is, &size)) {
+                return false;
+            }
+            if (size == 0) {
+                break;
+            }
+            if (!read_exact(is, &this->original_buffer, size)) {
+                return false;
+            }
+        }
+    }
 
-    is.read(this->original_buffer.data(), static_cast<int32_t>(this->original_size));
+    if (this->save_version >= 4 && !read_strings(is, &this->strings)) {
+        return false;
+    }
 
-    return true;
+    this->original_size = this->original_buffer.size();
+    return this->original_size > 0;
 }
@@ -8,26 +8,88 @@
 #include "cstdint"
 #include "fstream"
 #include "iterator"
+#include "memory"
+#include "ostream"
 #include "optional"
 #include "string"
+#include "tuple"
 #include "type_traits"
 #include "unordered_map"
 #include "variant"
 #include "vector"
 
+// Current version of the save format
+// 1, 2 - whole buffer with a single size header
+// 3 - buffer is split into chunks with 64 bit sizes, ended with an empty chunk
+// 4 - interned strings are saved as indices into a string table written after the chunks
+static constexpr size_t SAVE_STATE_VERSION = 4;
+
+// Maximum amount of elements in a single container
 static constexpr size_t SAVE_STATE_MAX_SIZE = 0x10000000;
 
+// Amount of bytes buffered before a chunk is written in streaming mode, also used as read size
+static constexpr size_t SAVE_STATE_CHUNK_SIZE = 0x10000;
+
+// Field that was added in a later save version, older saves are loaded without it
+template <size_t version, class Member> struct SaveFieldSince {
+    Member member;
+};
+
+template <size_t version, class Member>
+constexpr SaveFieldSince<version, Member> save_field_since(Member member) noexcept {
+    return {member};
+}
+
+// String field saved with SaveState::save_endpoint
+template <class Member> struct SaveFieldEndpoint {
+    Member member;
+};
+
+template <class Member>
+constexpr SaveFieldEndpoint<Member> save_field_endpoint(Member member) noexcept {
+    return {member};
+}
+
+// Structs list their saved fields in order with a static constexpr save_fields returning a tuple
+// of member pointers (or the wrappers above), save, can_load, load and save_size are generated
+template <class T>
+concept SaveFieldsList = requires { T::save_fields(); };
+
+// Vectors of these are copied with a single memcpy
+template <class T>
+concept SaveBulkCopyable = std::is_trivially_copyable<T>::value && !std::is_same<T, bool>::value;
+
 struct SaveState {
-    size_t save_version = {2};
+    size_t save_version = {SAVE_STATE_VERSION};
     size_t original_size = {};
     size_t load_idx = {};
     std::vector<char> original_buffer;
 
+    // When set saved data is written to it in chunks instead of being kept in original_buffer
+    std::ostream* stream = nullptr;
+
+    // Deduplicated strings referenced by index from the buffer
+    std::vector<InternedString> strings;
+    // Only used while saving, interned strings share data so their pointer is the key
+    std::unordered_map<const std::string*, size_t> string_ids;
+
     // helpers
     template <class T = void> void save(const char* ptr, size_t size = sizeof(T)) noexcept {
         assert(ptr);
         assert(size > 0);
-        std::copy(ptr, ptr + size, std::back_inserter(this->original_buffer));
+
+        if (this->stream && size >= SAVE_STATE_CHUNK_SIZE) {
+            // Big enough to be a chunk on it's own, don't copy it into the buffer
+            this->flush_stream();
+            this->write_chunk(ptr, size);
+            return;
+        }
+
+        this->original_buffer.insert(this->original_buffer.end(), ptr, ptr + size);
+
+        if (this->stream && this->original_buffer.size() >= SAVE_STATE_CHUNK_SIZE) {
+            this->flush_stream();
+        }
     }
 
     bool can_offset(size_t offset = 0) noexcept;
@@ -92,6 +154,20 @@ struct SaveState {
     bool can_load(const std::string& str) noexcept;
     void load(std::string& str) noexcept;
 
+    void save(const InternedString& str) noexcept;
+    bool can_load(const InternedString& str) noexcept;
+    void load(InternedString& str) noexcept;
+
+    // Saves a regular string through the string table
+    void save_interned(const std::string& str) noexcept;
+    bool can_load_interned(const std::string& str) noexcept;
+    void load_interned(std::string& str) noexcept;
+
+    // Saves an url as interned host and path, so the host is shared between all endpoints
+    void save_endpoint(const std::string& endpoint) noexcept;
+    bool can_load_endpoint(const std::string& endpoint) noexcept;
+    void load_endpoint(std::string& endpoint) noexcept;
+
     void save(const std::monostate&) noexcept {}
     bool can_load(const std::monostate&) noexcept { return true; }
     void load(std::monostate&) noexcept {}
@@ -105,8 +181,11 @@ struct SaveState {
         }
     }
 
-    template <class T> bool can_load(const std::optional<T>& opt) noexcept {
+    template <class T> bool can_load(const std::optional<T>&) noexcept {
         bool has_value;
+        if (!this->can_load_reset(has_value)) {
+            return false;
+        }
         this->load(has_value);
 
         if (has_value) {
@@ -220,12 +299,19 @@ struct SaveState {
         size_t size = vec.size();
         this->save(size);
 
+        if constexpr (SaveBulkCopyable<Element>) {
+            if (size > 0) {
+                this->save(reinterpret_cast<const char*>(vec.data()), size * sizeof(Element));
+            }
+            return;
+        }
+
         for (const auto& elem : vec) {
             this->save(elem);
         }
     }
 
-    template <class Element> bool can_load(const std::vector<Element>& vec) noexcept {
+    template <class Element> bool can_load(const std::vector<Element>&) noexcept {
         size_t size;
         if (!this->can_load_reset(size)) {
             return false;
@@ -235,6 +321,14 @@ struct SaveState {
             return false;
         }
 
+        if constexpr (SaveBulkCopyable<Element>) {
+            if (!this->can_offset(size * sizeof(Element))) {
+                return false;
+            }
+            this->load_idx += size * sizeof(Element);
+            return true;
+        }
+
         for (size_t i = 0; i < size; i++) {
             Element elem = {};
             if (!this->can_load(elem)) {
@@ -255,36 +349,199 @@ struct SaveState {
         }
         vec.resize(size);
 
+        if constexpr (SaveBulkCopyable<Element>) {
+            if (size > 0) {
+                this->load(reinterpret_cast<char*>(vec.data()), size * sizeof(Element));
+            }
+            return;
+        }
+
         for (auto& elem : vec) {
             this->load(elem);
         }
     }
 
+    template <class T, class Member> void save_field(const T& obj, Member T::*member) noexcept {
+        this->save(obj.*member);
+    }
+
+    template <class T, class Member>
+    bool can_load_field(const T& obj, Member T::*member) noexcept {
+        return this->can_load(obj.*member);
+    }
+
+    template <class T, class Member> void load_field(T& obj, Member T::*member) noexcept {
+        this->load(obj.*member);
+    }
+
+    template <class T, size_t version, class Member>
+    void save_field(const T& obj, SaveFieldSince<version, Member> field) noexcept {
+        this->save_field(obj, field.member);
+    }
+
+    template <class T, size_t version, class Member>
+    bool can_load_field(const T& obj, SaveFieldSince<version, Member> field) noexcept {
+        return this->save_version < version || this->can_load_field(obj, field.member);
+    }
+
+    template <class T, size_t version, class Member>
+    void load_field(T& obj, SaveFieldSince<version, Member> field) noexcept {
+        if (this->save_version >= version) {
+            this->load_field(obj, field.member);
+        }
+    }
+
+    template <class T, class Member>
+    void save_field(const T& obj, SaveFieldEndpoint<Member> field) noexcept {
+        this->save_endpoint(obj.*field.member);
+    }
+
+    template <class T, class Member>
+    bool can_load_field(const T& obj, SaveFieldEndpoint<Member> field) noexcept {
+        return this->can_load_endpoint(obj.*field.member);
+    }
+
+    template <class T, class Member>
+    void load_field(T& obj, SaveFieldEndpoint<Member> field) noexcept {
+        this->load_endpoint(obj.*field.member);
+    }
+
+    template <SaveFieldsList T> void save(const T& obj) noexcept {
+        std::apply([this, &obj](const auto&... fields) { (this->save_field(obj, fields), ...); },
+                   T::save_fields());
+    }
+
+    template <SaveFieldsList T> bool can_load(const T& obj) noexcept {
+        return std::apply(
+            [this, &obj](const auto&... fields) {
+                return (this->can_load_field(obj, fields) && ...);
+            },
+            T::save_fields());
+    }
+
+    template <SaveFieldsList T> void load(T& obj) noexcept {
+        std::apply([this, &obj](const auto&... fields) { (this->load_field(obj, fields), ...); },
+                   T::save_fields());
+    }
+
     // YOU HAVE TO BE CAREFUL NOT TO PASS POINTERS!
     template <class T>
-        requires(!std::is_trivially_copyable<T>::value)
+        requires(!std::is_trivially_copyable<T>::value && !SaveFieldsList<T>)
     void save(const T& any) noexcept {
         any.save(this);
     }
 
     // YOU HAVE TO BE CAREFUL NOT TO PASS POINTERS!
     template <class T>
-        requires(!std::is_trivially_copyable<T>::value)
+        requires(!std::is_trivially_copyable<T>::value && !SaveFieldsList<T>)
     bool can_load(const T& any) noexcept {
         return any.can_load(this);
     }
 
     // YOU HAVE TO BE CAREFUL NOT TO PASS POINTERS!
     template <class T>
-        requires(!std::is_trivially_copyable<T>::value)
+        requires(!std::is_trivially_copyable<T>::value && !SaveFieldsList<T>)
     void load(T& any) noexcept {
         any.load(this);
     }
 
+    // Amount of bytes save would append, used to reserve the buffer once
+    template <class T>
+        requires(std::is_trivially_copyable<T>::value)
+    static constexpr size_t save_size(const T&) noexcept {
+        return sizeof(T);
+    }
+
+    static size_t save_size(const std::string& str) noexcept {
+        return sizeof(size_t) + str.length();
+    }
+
+    static constexpr size_t save_size(const InternedString&) noexcept { return sizeof(size_t); }
+
+    static constexpr size_t save_size(const std::monostate&) noexcept { return 0; }
+
+    template <class T> static size_t save_size(const std::optional<T>& opt) noexcept {
+        return sizeof(bool) + (opt.has_value() ? save_size(opt.value()) : 0);
+    }
+
+    template <class K, class V>
+    static size_t save_size(const std::unordered_map<K, V>& map) noexcept {
+        size_t size = sizeof(size_t);
+        for (const auto& [k, v] : map) {
+            size += save_size(k) + save_size(v);
+        }
+        return size;
+    }
+
+    template <class... T> static size_t save_size(const std::variant<T...>& variant) noexcept {
+        return sizeof(size_t) +
+               std::visit([](const auto& s) { return save_size(s); }, variant);
+    }
+
+    template <class Element> static size_t save_size(const std::vector<Element>& vec) noexcept {
+        if constexpr (SaveBulkCopyable<Element>) {
+            return sizeof(size_t) + vec.size() * sizeof(Element);
+        }
+
+        size_t size = sizeof(size_t);
+        for (const auto& elem : vec) {
+            size += save_size(elem);
+        }
+        return size;
+    }
+
+    template <class T, class Member>
+    static size_t save_field_size(const T& obj, Member T::*member) noexcept {
+        return save_size(obj.*member);
+    }
+
+    template <class T, size_t version, class Member>
+    static size_t save_field_size(const T& obj, SaveFieldSince<version, Member> field) noexcept {
+        return save_field_size(obj, field.member);
+    }
+
+    template <class T, class Member>
+    static constexpr size_t save_field_size(const T&, SaveFieldEndpoint<Member>) noexcept {
+        return sizeof(size_t) * 2; // host and path ids
+    }
+
+    template <SaveFieldsList T> static size_t save_size(const T& obj) noexcept {
+        return std::apply(
+            [&obj](const auto&... fields) { return (save_field_size(obj, fields) + ... + 0); },
+            T::save_fields());
+    }
+
+    // Size of types with handwritten save isn't known, buffer grows on it's own
+    template <class T>
+        requires(!std::is_trivially_copyable<T>::value && !SaveFieldsList<T>)
+    static constexpr size_t save_size(const T&) noexcept {
+        return 0;
+    }
+
+    // Reserves the buffer for saving obj in a single allocation, ignored when streaming
+    template <class T> void reserve(const T& obj) noexcept {
+        if (!this->stream) {
+            this->original_buffer.reserve(this->original_buffer.size() + save_size(obj));
+        }
+    }
+
     void finish_save() noexcept;
 
     void reset_load() noexcept;
 
+    // Starts a streaming save into os, all following saves are written as chunks
+    // Returns false when failed
+    bool begin_stream(std::ostream* os) noexcept;
+
+    // Writes buffered data as a chunk
+    void flush_stream() noexcept;
+
+    // Writes remaining data and the end of the stream, used instead of finish_save
+    // Returns false when failed
+    bool finish_stream() noexcept;
+
+    void write_chunk(const char* ptr, size_t size) noexcept;
+
     // Returns false when failed
     bool write(std::ostream& os) const noexcept;
 
@@ -294,7 +551,11 @@ struct SaveState {
 
 struct UndoHistory {
     size_t undo_idx = 0;
-    std::vector<SaveState> undo_history = {};
+    // Shared so the current state can be handed to other threads without copying
+    std::vector<std::shared_ptr<SaveState>> undo_history = {};
+
+    // Changes every time the current state changes
+    size_t generation = 0;
 
     // should be called after every edit
     template <class T> void push_undo_history(const T* obj) noexcept {
@@ -305,11 +566,14 @@ struct UndoHistory {
             this->undo_history.resize(this->undo_idx + 1);
         }
 
-        SaveState* new_save = &this->undo_history.emplace_back();
+        SaveState* new_save =
+            this->undo_history.emplace_back(std::make_shared<SaveState>()).get();
+        new_save->reserve(*obj);
         new_save->save(*obj);
         new_save->finish_save();
 
         this->undo_idx = this->undo_history.size() - 1;
+        this->generation++;
     }
 
     template <class T> void reset_undo_history(const T* obj) noexcept {
@@ -319,14 +583,21 @@ struct UndoHistory {
         this->push_undo_history(obj);
     }
 
+    // Saved current state, it's never modified after being pushed (except for load_idx)
+    std::shared_ptr<const SaveState> current() const noexcept {
+        assert(this->undo_idx < this->undo_history.size());
+        return this->undo_history[this->undo_idx];
+    }
+
     constexpr bool can_undo() const noexcept { return this->undo_idx > 0; }
 
     template <class T> void undo(T* obj) noexcept {
         assert(this->can_undo());
 
         this->undo_idx--;
-        this->undo_history[this->undo_idx].load(*obj);
-        this->undo_history[this->undo_idx].reset_load();
+        this->undo_history[this->undo_idx]->load(*obj);
+        this->undo_history[this->undo_idx]->reset_load();
+        this->generation++;
     }
 
     constexpr bool can_redo() const noexcept {
@@ -337,8 +608,9 @@ struct UndoHistory {
         assert(this->can_redo());
 
         this->undo_idx++;
-        this->undo_history[this->undo_idx].load(*obj);
-        this->undo_history[this->undo_idx].reset_load();
+        this->undo_history[this->undo_idx]->load(*obj);
+        this->undo_history[this->undo_idx]->reset_load();
+        this->generation++;
     }
 
     UndoHistory() {}
@@ -0,0 +1,255 @@
+#include "search.hpp"
+
+#include "algorithm"
+#include "cassert"
+#include "cctype"
+#include "iterator"
+#include "utility"
+
+static char search_lower(char c) noexcept {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+static std::string search_lower(std::string_view text) noexcept {
+    std::string result(text.size(), '\0');
+    std::transform(text.begin(), text.end(), result.begin(),
+                   [](char c) { return search_lower(c); });
+    return result;
+}
+
+static void search_trigrams(std::string_view text, std::vector<uint32_t>* out) noexcept {
+    assert(out);
+
+    for (size_t i = 0; i + 3 <= text.size(); i++) {
+        uint32_t trigram = 0;
+        for (size_t j = i; j < i + 3; j++) {
+            trigram = trigram << 8 | static_cast<uint8_t>(search_lower(text[j]));
+        }
+        out->push_back(trigram);
+    }
+}
+
+static void search_unique(std::vector<uint32_t>* trigrams) noexcept {
+    assert(trigrams);
+
+    std::sort(trigrams->begin(), trigrams->end());
+    trigrams->erase(std::unique(trigrams->begin(), trigrams->end()), trigrams->end());
+}
+
+std::vector<uint32_t> search_trigrams(std::string_view text) noexcept {
+    std::vector<uint32_t> result;
+    search_trigrams(text, &result);
+    search_unique(&result);
+    return result;
+}
+
+static std::vector<uint32_t>
+search_document_trigrams(const std::vector<SearchField>& fields) noexcept {
+    // Trigrams never span two fields
+    std::vector<uint32_t> result;
+    for (const SearchField& field : fields) {
+        search_trigrams(field.text, &result);
+    }
+    search_unique(&result);
+    return result;
+}
+
+void SearchIndex::set(size_t id, std::vector<SearchField>&& fields) noexcept {
+    this->erase(id);
+
+    for (uint32_t trigram : search_document_trigrams(fields)) {
+        std::vector<size_t>& ids = this->postings[trigram];
+        ids.insert(std::lower_bound(ids.begin(), ids.end(), id), id);
+    }
+
+    this->documents.emplace(id, std::move(fields));
+}
+
+void SearchIndex::erase(size_t id) noexcept {
+    auto doc = this->documents.find(id);
+    if (doc == this->documents.end()) {
+        return;
+    }
+
+    for (uint32_t trigram : search_document_trigrams(doc->second)) {
+        auto it = this->postings.find(trigram);
+        assert(it != this->postings.end());
+
+        std::vector<size_t>& ids = it->second;
+        ids.erase(std::lower_bound(ids.begin(), ids.end(), id));
+        if (ids.empty()) {
+            this->postings.erase(it);
+        }
+    }
+
+    this->documents.erase(doc);
+}
+
+void SearchIndex::clear() noexcept {
+    this->postings.clear();
+    this->documents.clear();
+}
+
+std::vector<SearchMatch> SearchIndex::search(std::string_view query,
+                                             uint8_t kinds) const noexcept {
+    std::string needle = search_lower(query);
+    std::vector<size_t> candidates;
+
+    if (needle.size() < 3) {
+        // Too short for trigrams, every document is a candidate
+        candidates.reserve(this->documents.size());
+        for (const auto& [id, _] : this->documents) {
+            candidates.push_back(id);
+        }
+        std::sort(candidates.begin(), candidates.end());
+    } else {
+        std::vector<const std::vector<size_t>*> lists;
+        for (uint32_t trigram : search_trigrams(needle)) {
+            auto it = this->postings.find(trigram);
+            if (it == this->postings.end()) {
+                return {};
+            }
+            lists.push_back(&it->second);
+        }
+
+        // Intersecting from the rarest trigram keeps the candidates small
+        std::sort(lists.begin(), lists.end(),
+                  [](const auto* a, const auto* b) { return a->size() < b->size(); });
+
+        candidates = *lists[0];
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+            std::vector<size_t> intersection;
+            std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(),
+                                  lists[i]->end(), std::back_inserter(intersection));
+            candidates = std::move(intersection);
+        }
+    }
+
+    // Trigrams only narrow down the documents, their order still has to be checked
+    std::vector<SearchMatch> result;
+    for (size_t id : candidates) {
+        const std::vector<SearchField>& fields = this->documents.at(id);
+        for (size_t field = 0; field < fields.size(); field++) {
+            if (kinds & (1 << fields[field].kind) &&
+                search_find(fields[field].text, needle) != std::string::npos) {
+                result.push_back({.id = id, .field = field});
+            }
+        }
+    }
+    return result;
+}
+
+size_t search_find(std::string_view text, std::string_view query) noexcept {
+    auto it = std::search(text.begin(), text.end(), query.begin(), query.end(),
+                          [](char a, char b) { return search_lower(a) == search_lower(b); });
+    return it == text.end() && !query.empty() ? std::string::npos
+                                               : static_cast<size_t>(it - text.begin());
+}
+
+static bool search_token_char(char c) noexcept {
+    unsigned char byte = static_cast<unsigned char>(c);
+    return std::isalnum(byte) || byte == '_' || byte >= 0x80;
+}
+
+void SearchTokenizer::feed(std::string_view text) noexcept {
+    for (char c : text) {
+        if (search_token_char(c)) {
+            if (this->token.size() < SEARCH_TOKEN_MAX) {
+                this->token.push_back(search_lower(c));
+            }
+        } else if (!this->token.empty()) {
+            this->tokens.insert(std::move(this->token));
+            this->token.clear();
+        }
+    }
+}
+
+std::vector<std::string> SearchTokenizer::finish() noexcept {
+    if (!this->token.empty()) {
+        this->tokens.insert(std::move(this->token));
+        this->token.clear();
+    }
+
+    std::vector<std::string> result;
+    result.reserve(this->tokens.size());
+    while (!this->tokens.empty()) {
+        result.push_back(std::move(this->tokens.extract(this->tokens.begin()).value()));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<std::string> search_tokens(std::string_view text) noexcept {
+    SearchTokenizer tokenizer;
+    tokenizer.feed(text);
+    return tokenizer.finish();
+}
+
+void SearchTokenIndex::set(size_t id, std::vector<std::string>&& tokens) noexcept {
+    this->erase(id);
+
+    for (const std::string& token : tokens) {
+        std::vector<size_t>& ids = this->postings[token];
+        ids.insert(std::lower_bound(ids.begin(), ids.end(), id), id);
+    }
+
+    this->documents.emplace(id, std::move(tokens));
+}
+
+void SearchTokenIndex::erase(size_t id) noexcept {
+    auto doc = this->documents.find(id);
+    if (doc == this->documents.end()) {
+        return;
+    }
+
+    for (const std::string& token : doc->second) {
+        auto it = this->postings.find(token);
+        assert(it != this->postings.end());
+
+        std::vector<size_t>& ids = it->second;
+        ids.erase(std::lower_bound(ids.begin(), ids.end(), id));
+        if (ids.empty()) {
+            this->postings.erase(it);
+        }
+    }
+
+    this->documents.erase(doc);
+}
+
+void SearchTokenIndex::clear() noexcept {
+    this->postings.clear();
+    this->documents.clear();
+}
+
+std::vector<size_t> SearchTokenIndex::search(std::string_view query) const noexcept {
+    std::vector<std::string> words = search_tokens(query);
+    if (words.empty()) {
+        return {};
+    }
+
+    std::vector<size_t> result;
+    for (size_t i = 0; i < words.size(); i++) {
+        // Every word starting with the query word is next to it in the map
+        std::vector<size_t> ids;
+        for (auto it = this->postings.lower_bound(words[i]);
+             it != this->postings.end() && it->first.starts_with(words[i]); it++) {
+            ids.insert(ids.end(), it->second.begin(), it->second.end());
+        }
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+        if (i == 0) {
+            result = std::move(ids);
+        } else {
+            std::vector<size_t> intersection;
+            std::set_intersection(result.begin(), result.end(), ids.begin(), ids.end(),
+                                  std::back_inserter(intersection));
+            result = std::move(intersection);
+        }
+
+        if (result.empty()) {
+            break;
+        }
+    }
+    return result;
+}
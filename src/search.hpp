@@ -0,0 +1,103 @@
+#pragma once
+
+#include "cstddef"
+#include "cstdint"
+#include "map"
+#include "string"
+#include "string_view"
+#include "unordered_map"
+#include "unordered_set"
+#include "vector"
+
+enum SearchFieldKind : uint8_t {
+    SEARCH_NAME,
+    SEARCH_ENDPOINT,
+    SEARCH_HEADER,
+    SEARCH_PARAMETER,
+    SEARCH_BODY,
+};
+inline constexpr const char* SearchFieldKindLabels[] = {
+    "Name", "Endpoint", "Header", "Parameter", "Body",
+};
+
+enum SearchKinds : uint8_t {
+    SEARCH_KIND_NONE = 0,
+    SEARCH_KIND_NAME = 1 << SEARCH_NAME,
+    SEARCH_KIND_ENDPOINT = 1 << SEARCH_ENDPOINT,
+    SEARCH_KIND_HEADER = 1 << SEARCH_HEADER,
+    SEARCH_KIND_PARAMETER = 1 << SEARCH_PARAMETER,
+    SEARCH_KIND_BODY = 1 << SEARCH_BODY,
+    SEARCH_KIND_ALL = 0x1f,
+};
+
+struct SearchField {
+    SearchFieldKind kind;
+    std::string text;
+};
+
+struct SearchMatch {
+    size_t id;
+    // Index into the fields the document was added with
+    size_t field;
+};
+
+// Case insensitive substring search over the text fields of documents, every 3 byte
+// sequence of a document maps to the ids containing it so only documents having all of
+// the query trigrams are compared
+struct SearchIndex {
+    // Sorted ids for every trigram
+    std::unordered_map<uint32_t, std::vector<size_t>> postings = {};
+    std::unordered_map<size_t, std::vector<SearchField>> documents = {};
+
+    // Replaces the document when it's already indexed
+    void set(size_t id, std::vector<SearchField>&& fields) noexcept;
+    void erase(size_t id) noexcept;
+    void clear() noexcept;
+
+    bool contains(size_t id) const noexcept { return this->documents.contains(id); }
+
+    // Matching fields ordered by id, kinds is a mask of SearchKinds
+    std::vector<SearchMatch> search(std::string_view query,
+                                    uint8_t kinds = SEARCH_KIND_ALL) const noexcept;
+};
+
+// Unique sorted trigrams of the lowercase text
+std::vector<uint32_t> search_trigrams(std::string_view text) noexcept;
+
+// Case insensitive find, returns std::string::npos when not found
+size_t search_find(std::string_view text, std::string_view query) noexcept;
+
+// Longer words are indexed by their start
+constexpr size_t SEARCH_TOKEN_MAX = 64;
+
+// Splits text given a part at a time into lowercase words of letters, digits and '_',
+// bytes past ascii count as letters so utf-8 words stay whole
+struct SearchTokenizer {
+    // Word cut by the end of the last part
+    std::string token = "";
+    std::unordered_set<std::string> tokens = {};
+
+    void feed(std::string_view text) noexcept;
+    // Unique sorted words of everything fed so far, the tokenizer is empty afterwards
+    std::vector<std::string> finish() noexcept;
+};
+
+// Words of a text in one part
+std::vector<std::string> search_tokens(std::string_view text) noexcept;
+
+// Inverted index from words to the documents containing them, the text of documents isn't
+// kept so any number of large bodies can be searched without reading them again
+struct SearchTokenIndex {
+    // Sorted ids for every word, ordered so words sharing a start are next to each other
+    std::map<std::string, std::vector<size_t>, std::less<>> postings = {};
+    // Words of every document, needed to remove it
+    std::unordered_map<size_t, std::vector<std::string>> documents = {};
+
+    // Replaces the document when it's already indexed, tokens are unique
+    void set(size_t id, std::vector<std::string>&& tokens) noexcept;
+    void erase(size_t id) noexcept;
+    void clear() noexcept;
+
+    // Sorted ids of documents having a word starting with every word of the query
+    std::vector<size_t> search(std::string_view query) const noexcept;
+};
@@ -0,0 +1,292 @@
+#include "sync.hpp"
+
+#include "chunks.hpp"
+
+#include "../external/json/single_include/nlohmann/json.hpp"
+
+#include "cassert"
+#include "charconv"
+#include "filesystem"
+#include "fstream"
+#include "sstream"
+
+std::string sync_content_hash(std::string_view data) noexcept {
+    return chunk_hash(data).to_hex();
+}
+
+std::string SyncCache::path(const std::string& name) const noexcept {
+    // Remote file names can contain anything so they are hashed
+    return (std::filesystem::path(this->dir) / (chunk_hash(name).to_hex() + ".wt")).string();
+}
+
+std::optional<std::string> SyncCache::get(const std::string& name) const noexcept {
+    std::ifstream in(this->path(name), std::ios::binary);
+    if (!in) {
+        return std::nullopt;
+    }
+
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+bool SyncCache::put(const std::string& name, std::string_view data) const noexcept {
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::create_directories(this->dir, ec);
+
+    // Written under a temporary name so an interrupted write never leaves a wrong base
+    std::string path = this->path(name);
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            fs::remove(tmp_path, ec);
+            return false;
+        }
+    }
+
+    fs::rename(tmp_path, path, ec);
+    return !ec;
+}
+
+void SyncCache::erase(const std::string& name) const noexcept {
+    std::error_code ec;
+    std::filesystem::remove(this->path(name), ec);
+}
+
+void SyncCache::rename(const std::string& old_name, const std::string& new_name) const noexcept {
+    std::error_code ec;
+    std::filesystem::rename(this->path(old_name), this->path(new_name), ec);
+}
+
+std::unique_ptr<httplib::Client> SyncClientPool::acquire(const std::string& host) noexcept {
+    std::unique_ptr<httplib::Client> cli;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->hostname != host) {
+            // Sync server was changed, old connections are useless
+            this->idle.clear();
+            this->hostname = host;
+        }
+
+        if (!this->idle.empty()) {
+            cli = std::move(this->idle.back());
+            this->idle.pop_back();
+        }
+    }
+
+    if (!cli) {
+        cli = std::make_unique<httplib::Client>(host);
+        cli->set_keep_alive(true);
+    }
+
+    // Might have been changed by the previous user
+    cli->set_follow_location(true);
+    return cli;
+}
+
+void SyncClientPool::release(const std::string& host,
+                             std::unique_ptr<httplib::Client> cli) noexcept {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (cli && cli->is_valid() && this->hostname == host && this->idle.size() < max_idle) {
+        this->idle.push_back(std::move(cli));
+    }
+}
+
+SyncClient::SyncClient(SyncClientPool* _pool, const std::string& _hostname) noexcept
+    : pool(_pool), hostname(_hostname) {
+    assert(this->pool);
+    this->cli = this->pool->acquire(this->hostname);
+}
+
+SyncClient::~SyncClient() noexcept { this->pool->release(this->hostname, std::move(this->cli)); }
+
+std::string sync_status_error(const httplib::Result& result) noexcept {
+    if (result.error() != httplib::Error::Success) {
+        return to_string(result.error());
+    }
+
+    if (result->status != 200) {
+        if (result->body != "") {
+            return result->body;
+        }
+        return httplib::status_message(result->status);
+    }
+
+    return "";
+}
+
+std::optional<std::string> sync_upload_pieces(httplib::Client& cli, const httplib::Params& params,
+                                              std::string_view data) noexcept {
+    httplib::Params start_params = params;
+    start_params.emplace("size", std::to_string(data.size()));
+    start_params.emplace("hash", sync_content_hash(data));
+
+    httplib::Result start =
+        cli.Post(httplib::append_query_params("/file-upload", start_params), "", "text/plain");
+    if (!sync_status_error(start).empty() || start->body.empty()) {
+        return std::nullopt;
+    }
+
+    httplib::Params upload_params = params;
+    upload_params.emplace("upload_id", start->body);
+
+    size_t offset = 0;
+    size_t retries = 0;
+    while (offset < data.size()) {
+        size_t size = std::min(SYNC_UPLOAD_PIECE_SIZE, data.size() - offset);
+
+        httplib::Params piece_params = upload_params;
+        piece_params.emplace("offset", std::to_string(offset));
+
+        // Pieces point into data so nothing is copied
+        httplib::Result piece = cli.Put(
+            httplib::append_query_params("/file-upload", piece_params), httplib::Headers{},
+            data.data() + offset, size, "application/octet-stream");
+        std::string error = sync_status_error(piece);
+        if (error.empty()) {
+            offset += size;
+            retries = 0;
+            continue;
+        }
+
+        if (++retries > SYNC_UPLOAD_RETRIES) {
+            return error;
+        }
+
+        // Piece might have arrived even if the reply didn't, continue from what the server has
+        httplib::Result status =
+            cli.Get(httplib::append_query_params("/file-upload", upload_params));
+        if (sync_status_error(status).empty()) {
+            size_t received = 0;
+            const std::string& body = status->body;
+            auto [ptr, ec] = std::from_chars(body.data(), body.data() + body.size(), received);
+            if (ec == std::errc{} && received <= data.size()) {
+                offset = received;
+            }
+        }
+    }
+
+    httplib::Result finish = cli.Post(
+        httplib::append_query_params("/file-upload-finish", upload_params), "", "text/plain");
+    return sync_status_error(finish);
+}
+
+std::string sync_upload(httplib::Client& cli, const httplib::Params& params,
+                        const std::string& data,
+                        const std::optional<std::string>& base,
+                        const std::string& base_name) noexcept {
+    if (base.has_value()) {
+        std::string delta = delta_encode(base.value(), data);
+
+        // Not worth it when most of the file changed
+        if (delta.size() < data.size()) {
+            httplib::Params delta_params = params;
+            delta_params.emplace("base_hash", sync_content_hash(base.value()));
+            if (!base_name.empty()) {
+                delta_params.emplace("base_name", base_name);
+            }
+
+            httplib::Result result =
+                cli.Post(httplib::append_query_params("/file-delta", delta_params), delta,
+                         "application/octet-stream");
+            if (sync_status_error(result).empty()) {
+                return "";
+            }
+            // Server has a different version or doesn't support deltas
+        }
+    }
+
+    if (data.size() > SYNC_UPLOAD_PIECE_SIZE) {
+        std::optional<std::string> error = sync_upload_pieces(cli, params, data);
+        if (error.has_value()) {
+            return error.value();
+        }
+        // Server doesn't support uploads in pieces
+    }
+
+    httplib::Result result = cli.Post(httplib::append_query_params("/file", params), data,
+                                      "application/octet-stream");
+    return sync_status_error(result);
+}
+
+// Responses that httplib would follow when following redirects, 304 has no location
+static bool sync_is_redirect(const httplib::Result& result) noexcept {
+    return result && result->status > 300 && result->status < 400 && result->status != 304 &&
+           result->has_header("Location");
+}
+
+std::optional<std::string> sync_download(httplib::Client& cli, const httplib::Params& params,
+                                         const std::optional<std::string>& cached,
+                                         std::string* error) noexcept {
+    assert(error);
+
+    httplib::Headers headers;
+    if (cached.has_value()) {
+        headers.emplace("If-None-Match", '"' + sync_content_hash(cached.value()) + '"');
+        // httplib fails on a 304 when following redirects, so they are followed here instead
+        cli.set_follow_location(false);
+    }
+
+    httplib::Result result = cli.Get(httplib::append_query_params("/file", params), headers);
+
+    // Redirects to another host get their own client
+    httplib::Client* current = &cli;
+    std::unique_ptr<httplib::Client> other;
+    for (size_t i = 0; i < SYNC_REDIRECTS_MAX && sync_is_redirect(result); i++) {
+        std::string location = result->get_header_value("Location");
+        size_t scheme = location.find("://");
+        if (scheme != std::string::npos) {
+            size_t path = location.find('/', scheme + 3);
+            other = std::make_unique<httplib::Client>(location.substr(0, path));
+            other->set_follow_location(false);
+            current = other.get();
+            location = path != std::string::npos ? location.substr(path) : "/";
+        }
+
+        result = current->Get(location, headers);
+    }
+    cli.set_follow_location(true);
+
+    if (result && result->status == 304 && cached.has_value()) {
+        return cached;
+    }
+
+    *error = sync_status_error(result);
+    if (!error->empty()) {
+        return std::nullopt;
+    }
+
+    return std::move(result->body);
+}
+
+std::string sync_delete(httplib::Client& cli, const httplib::Params& params,
+                        const std::vector<std::string>& names) noexcept {
+    if (names.empty()) {
+        return "";
+    }
+
+    httplib::Result result =
+        cli.Post(httplib::append_query_params("/file-batch-delete", params),
+                 nlohmann::json(names).dump(), "application/json");
+    if (sync_status_error(result).empty()) {
+        return "";
+    }
+
+    // Older servers, connection is kept alive between these
+    for (const std::string& name : names) {
+        httplib::Params file_params = params;
+        file_params.emplace("file_name", name);
+
+        std::string error = sync_status_error(cli.Delete(
+            httplib::append_query_params("/file", file_params), "", "application/octet-stream"));
+        if (!error.empty()) {
+            return error;
+        }
+    }
+
+    return "";
+}
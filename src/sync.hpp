@@ -0,0 +1,100 @@
+#pragma once
+
+#include <httplib.h>
+
+#include "memory"
+#include "mutex"
+#include "optional"
+#include "string"
+#include "string_view"
+#include "vector"
+
+// Sync server protocol on top of /file
+// GET /file with If-None-Match: "hash" replies 304 when the file is unchanged
+// POST /file-delta with base_hash parameter applies a delta made by delta_encode,
+// any error including missing endpoint means the full file has to be sent to POST /file
+//   with a base_name parameter the delta applies to that file and the result is saved as a copy
+// POST /file-batch-delete with a JSON array of names, without it files are deleted one by one
+// Large files are uploaded in pieces so a dropped connection only resends the current piece
+//   POST /file-upload with size and hash parameters starts an upload and replies with its id
+//   PUT /file-upload with upload_id and offset parameters appends a piece
+//   GET /file-upload with upload_id replies with the amount of bytes received so far
+//   POST /file-upload-finish with upload_id checks the hash and replaces the file
+// when starting an upload fails the whole file is sent to POST /file
+
+constexpr size_t SYNC_UPLOAD_PIECE_SIZE = 0x100000; // 1 MiB
+constexpr size_t SYNC_UPLOAD_RETRIES = 3;
+constexpr size_t SYNC_REDIRECTS_MAX = 20;
+
+// Hex hash identifying contents of a synced file
+std::string sync_content_hash(std::string_view data) noexcept;
+
+// Last contents acknowledged by the sync server for every file, base for deltas
+struct SyncCache {
+    std::string dir;
+
+    std::string path(const std::string& name) const noexcept;
+
+    std::optional<std::string> get(const std::string& name) const noexcept;
+    // Returns false when failed
+    bool put(const std::string& name, std::string_view data) const noexcept;
+    void erase(const std::string& name) const noexcept;
+    void rename(const std::string& old_name, const std::string& new_name) const noexcept;
+};
+
+// Keeps connections to the sync server alive between requests
+// Clients aren't thread safe so each one is only lent to a single thread at a time
+struct SyncClientPool {
+    static constexpr size_t max_idle = 4;
+
+    std::mutex mutex;
+    std::string hostname;
+    std::vector<std::unique_ptr<httplib::Client>> idle;
+
+    std::unique_ptr<httplib::Client> acquire(const std::string& hostname) noexcept;
+    void release(const std::string& hostname, std::unique_ptr<httplib::Client> cli) noexcept;
+};
+
+// Client borrowed from a pool for the duration of the scope
+struct SyncClient {
+    SyncClientPool* pool;
+    std::string hostname;
+    std::unique_ptr<httplib::Client> cli;
+
+    SyncClient(SyncClientPool* _pool, const std::string& _hostname) noexcept;
+    ~SyncClient() noexcept;
+
+    SyncClient(const SyncClient&) = delete;
+    SyncClient& operator=(const SyncClient&) = delete;
+
+    httplib::Client& operator*() noexcept { return *this->cli; }
+    httplib::Client* operator->() noexcept { return this->cli.get(); }
+};
+
+// Returns an error, empty when succeeded
+std::string sync_status_error(const httplib::Result& result) noexcept;
+
+// Uploads data in pieces resuming from what the server has after failures
+// Returns std::nullopt when the server doesn't support it, otherwise an error, empty when succeeded
+std::optional<std::string> sync_upload_pieces(httplib::Client& cli, const httplib::Params& params,
+                                              std::string_view data) noexcept;
+
+// Uploads data as a delta against base when given, falls back to the full file
+// base_name is the file base is the contents of, the uploaded one when empty
+// Returns an error, empty when succeeded
+std::string sync_upload(httplib::Client& cli, const httplib::Params& params,
+                        const std::string& data,
+                        const std::optional<std::string>& base = std::nullopt,
+                        const std::string& base_name = "") noexcept;
+
+// Downloads a file, cached is returned when the server reports it unchanged
+// Redirects are followed and cli is left following them
+// Returns std::nullopt and sets error when failed
+std::optional<std::string> sync_download(httplib::Client& cli, const httplib::Params& params,
+                                         const std::optional<std::string>& cached,
+                                         std::string* error) noexcept;
+
+// Deletes all files in a single request when the server supports it
+// Returns an error, empty when succeeded
+std::string sync_delete(httplib::Client& cli, const httplib::Params& params,
+                        const std::vector<std::string>& names) noexcept;
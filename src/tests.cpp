@@ -78,330 +78,10 @@ MultiPartBody request_multipart_convert_json(const nlohmann::json& json) noexcep
     return to_replace;
 }
 
-void Request::save(SaveState* save) const noexcept {
-    assert(save);
-
-    save->save(this->body_type);
-    save->save(this->other_content_type);
-    save->save(this->body);
-    save->save(this->cookies);
-    save->save(this->parameters);
-    save->save(this->headers);
-}
-
-bool Request::can_load(SaveState* save) const noexcept {
-    assert(save);
-
-    if (!save->can_load(this->body_type)) {
-        return false;
-    }
-    if (!save->can_load(this->other_content_type)) {
-        return false;
-    }
-    if (!save->can_load(this->body)) {
-        return false;
-    }
-    if (!save->can_load(this->cookies)) {
-        return false;
-    }
-    if (!save->can_load(this->parameters)) {
-        return false;
-    }
-    if (!save->can_load(this->headers)) {
-        return false;
-    }
-
-    return true;
-}
-
-void Request::load(SaveState* save) noexcept {
-    assert(save);
-
-    save->load(this->body_type);
-    save->load(this->other_content_type);
-    save->load(this->body);
-    save->load(this->cookies);
-    save->load(this->parameters);
-    save->load(this->headers);
-}
-
-void Response::save(SaveState* save) const noexcept {
-    assert(save);
-
-    save->save(this->status);
-    save->save(this->body_type);
-    save->save(this->other_content_type);
-    save->save(this->body);
-    save->save(this->cookies);
-    save->save(this->headers);
-}
-
-bool Response::can_load(SaveState* save) const noexcept {
-    assert(save);
-
-    if (!save->can_load(this->status)) {
-        return false;
-    }
-    if (!save->can_load(this->body_type)) {
-        return false;
-    }
-    if (!save->can_load(this->other_content_type)) {
-        return false;
-    }
-    if (!save->can_load(this->body)) {
-        return false;
-    }
-    if (!save->can_load(this->cookies)) {
-        return false;
-    }
-    if (!save->can_load(this->headers)) {
-        return false;
-    }
-    return true;
-}
-
-void Response::load(SaveState* save) noexcept {
-    assert(save);
-
-    save->load(this->status);
-    save->load(this->body_type);
-    save->load(this->other_content_type);
-    save->load(this->body);
-    save->load(this->cookies);
-    save->load(this->headers);
-}
-
-void AuthBasic::save(SaveState* save) const noexcept {
-    assert(save);
-
-    save->save(this->name);
-    save->save(this->password);
-}
-
-bool AuthBasic::can_load(SaveState* save) const noexcept {
-    assert(save);
-
-    if (!save->can_load(this->name)) {
-        return false;
-    }
-
-    if (!save->can_load(this->password)) {
-        return false;
-    }
-
-    return true;
-}
-
-void AuthBasic::load(SaveState* save) noexcept {
-    assert(save);
-
-    save->load(this->name);
-    save->load(this->password);
-}
-
-void AuthBearerToken::save(SaveState* save) const noexcept {
-    assert(save);
-
-    save->save(this->token);
-}
-
-bool AuthBearerToken::can_load(SaveState* save) const noexcept {
-    assert(save);
-
-    if (!save->can_load(this->token)) {
-        return false;
-    }
-
-    return true;
-}
-
-void AuthBearerToken::load(SaveState* save) noexcept {
-    assert(save);
-
-    save->load(this->token);
-}
-
-void ClientSettings::save(SaveState* save) const noexcept {
-    assert(save);
-
-    save->save(this->flags);
-
-    save->save(this->auth);
-    // NOTE: can disable save when CLIENT_PROXY isn't set
-    save->save(this->proxy_host);
-    save->save(this->proxy_port);
-    save->save(this->proxy_auth);
-
-    save->save(this->seconds_timeout);
-    save->save(this->test_reruns);
-}
-
-bool ClientSettings::can_load(SaveState* save) const noexcept {
-    assert(save);
-
-    if (!save->can_load(this->flags)) {
-        return false;
-    }
-
-    if (!save->can_load(this->auth)) {
-        return false;
-    }
-
-    if (!save->can_load(this->proxy_host)) {
-        return false;
-    }
-
-    if (!save->can_load(this->proxy_port)) {
-        return false;
-    }
-
-    if (!save->can_load(this->proxy_auth)) {
-        return false;
-    }
-
-    if (!save->can_load(this->seconds_timeout)) {
-        return false;
-    }
-
-    if (!save->can_load(this->test_reruns)) {
-        return false;
-    }
-
-    return true;
-}
-
-void ClientSettings::load(SaveState* save) noexcept {
-    assert(save);
-
-    save->load(this->flags);
-
-    save->load(this->auth);
-
-    save->load(this->proxy_host);
-    save->load(this->proxy_port);
-    save->load(this->proxy_auth);
-
-    save->load(this->seconds_timeout);
-    save->load(this->test_reruns);
-}
-
 std::string Test::label() const noexcept { return this->endpoint + "##" + to_string(this->id); }
 
-void Test::save(SaveState* save) const noexcept {
-    assert(save);
-
-    save->save(this->id);
-    save->save(this->parent_id);
-    save->save(this->type);
-    save->save(this->flags);
-    save->save(this->endpoint);
-    save->save(this->variables);
-    save->save(this->request);
-    save->save(this->response);
-    save->save(this->cli_settings);
-}
-
-bool Test::can_load(SaveState* save) const noexcept {
-    assert(save);
-
-    if (!save->can_load(this->id)) {
-        return false;
-    }
-    if (!save->can_load(this->parent_id)) {
-        return false;
-    }
-    if (!save->can_load(this->type)) {
-        return false;
-    }
-    if (!save->can_load(this->flags)) {
-        return false;
-    }
-    if (!save->can_load(this->endpoint)) {
-        return false;
-    }
-    if (!save->can_load(this->variables)) {
-        return false;
-    }
-    if (!save->can_load(this->request)) {
-        return false;
-    }
-    if (!save->can_load(this->response)) {
-        return false;
-    }
-    if (!save->can_load(this->cli_settings)) {
-        return false;
-    }
-    return true;
-}
-
-void Test::load(SaveState* save) noexcept {
-    assert(save);
-
-    save->load(this->id);
-    save->load(this->parent_id);
-    save->load(this->type);
-    save->load(this->flags);
-    save->load(this->endpoint);
-    save->load(this->variables);
-    save->load(this->request);
-    save->load(this->response);
-    save->load(this->cli_settings);
-}
-
 std::string Group::label() const noexcept { return this->name + "##" + to_string(this->id); }
 
-void Group::save(SaveState* save) const noexcept {
-    assert(save);
-
-    save->save(this->id);
-    save->save(this->parent_id);
-    save->save(this->flags);
-    save->save(this->name);
-    save->save(this->children_ids);
-    save->save(this->cli_settings);
-    save->save(this->variables);
-}
-
-bool Group::can_load(SaveState* save) const noexcept {
-    assert(save);
-
-    if (!save->can_load(this->id)) {
-        return false;
-    }
-    if (!save->can_load(this->parent_id)) {
-        return false;
-    }
-    if (!save->can_load(this->flags)) {
-        return false;
-    }
-    if (!save->can_load(this->name)) {
-        return false;
-    }
-    if (!save->can_load(this->children_ids)) {
-        return false;
-    }
-    if (!save->can_load(this->cli_settings)) {
-        return false;
-    }
-    if (!save->can_load(this->variables)) {
-        return false;
-    }
-
-    return true;
-}
-
-void Group::load(SaveState* save) noexcept {
-    assert(save);
-
-    save->load(this->id);
-    save->load(this->parent_id);
-    save->load(this->flags);
-    save->load(this->name);
-    save->load(this->children_ids);
-    save->load(this->cli_settings);
-    save->load(this->variables);
-}
-
 RequestBodyType request_body_type(const std::string& str) noexcept {
     if (str == "application/json") {
         return REQUEST_JSON;
@@ -618,3 +298,35 @@ httplib::Headers response_headers(const VariablesMap& vars, const Test* test) no
 
     return result;
 }
+
+void ResultCounters::add(TestResultStatus status) noexcept { this->counts[status]++; }
+
+void ResultCounters::move(TestResultStatus from, TestResultStatus to) noexcept {
+    // Target first so a result is never missing from both while it moves
+    this->counts[to]++;
+    this->counts[from]--;
+
+    if (to != STATUS_WAITING && to != STATUS_RUNNING) {
+        this->last_finish.store((std::chrono::steady_clock::now() - this->start).count());
+    }
+}
+
+size_t ResultCounters::finished() const noexcept {
+    return this->count(STATUS_OK) + this->count(STATUS_CANCELLED) + this->count(STATUS_WARNING) +
+           this->count(STATUS_ERROR);
+}
+
+bool ResultCounters::running() const noexcept {
+    // Waiting is read first, a result leaving it is already counted as running by then
+    size_t waiting = this->count(STATUS_WAITING);
+    return waiting + this->count(STATUS_RUNNING) > 0;
+}
+
+float ResultCounters::throughput() const noexcept {
+    std::chrono::duration<float> elapsed =
+        std::chrono::steady_clock::duration(this->last_finish.load());
+    if (elapsed.count() <= 0) {
+        return 0;
+    }
+    return static_cast<float>(this->finished()) / elapsed.count();
+}
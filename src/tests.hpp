@@ -2,14 +2,20 @@
 
 #include "hello_imgui/hello_imgui_logger.h"
 
+#include "diff.hpp"
 #include "http.hpp"
 #include "json.hpp"
 #include "partial_dict.hpp"
+#include "textview.hpp"
 #include "variables.hpp"
 #include "utils.hpp"
 
+#include "array"
+#include "atomic"
+#include "chrono"
 #include "cmath"
 #include "cstdint"
+#include "memory"
 #include "optional"
 #include "string"
 #include "unordered_map"
@@ -55,9 +61,10 @@ struct Request {
     Parameters parameters;
     Headers headers;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&Request::body_type, &Request::other_content_type, &Request::body,
+                               &Request::cookies, &Request::parameters, &Request::headers);
+    }
 
     constexpr bool operator==(const Request& other) const noexcept {
         return this->body_type == other.body_type &&
@@ -85,9 +92,11 @@ struct Response {
     Cookies cookies;
     Headers headers;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&Response::status, &Response::body_type,
+                               &Response::other_content_type, &Response::body, &Response::cookies,
+                               &Response::headers);
+    }
 
     constexpr bool operator==(const Response& other) const noexcept {
         return this->status == other.status &&
@@ -102,17 +111,17 @@ struct AuthBasic {
     std::string name;
     std::string password;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&AuthBasic::name, &AuthBasic::password);
+    }
 };
 
 struct AuthBearerToken {
     std::string token;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&AuthBearerToken::token);
+    }
 };
 
 using AuthVariant = std::variant<std::monostate, AuthBasic, AuthBearerToken>;
@@ -149,9 +158,12 @@ struct ClientSettings {
     size_t seconds_timeout = 10;
     size_t test_reruns = 1;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&ClientSettings::flags, &ClientSettings::auth,
+                               &ClientSettings::proxy_host, &ClientSettings::proxy_port,
+                               &ClientSettings::proxy_auth, &ClientSettings::seconds_timeout,
+                               &ClientSettings::test_reruns);
+    }
 
     constexpr bool operator==(const ClientSettings& other) const noexcept {
         return this->flags == other.flags;
@@ -179,9 +191,11 @@ struct Test {
 
     std::string label() const noexcept;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&Test::id, &Test::parent_id, &Test::type, &Test::flags,
+                               save_field_endpoint(&Test::endpoint), &Test::variables,
+                               &Test::request, &Test::response, &Test::cli_settings);
+    }
 };
 
 void test_resolve_url_variables(const VariablesMap& parent_vars, Test* test) noexcept;
@@ -203,6 +217,58 @@ static const char* TestResultStatusLabels[] = {
     /* [STATUS_ERROR] = */ reinterpret_cast<const char*>("Error"),
 };
 
+// Amount of results in every status, moved between them whenever a status changes
+struct ResultCounters {
+    std::array<std::atomic<size_t>, ARRAY_SIZE(TestResultStatusLabels)> counts = {};
+
+    // For throughput
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::atomic<std::chrono::steady_clock::duration::rep> last_finish = 0;
+
+    void add(TestResultStatus status) noexcept;
+    void move(TestResultStatus from, TestResultStatus to) noexcept;
+
+    size_t count(TestResultStatus status) const noexcept { return this->counts[status].load(); }
+    size_t finished() const noexcept;
+    // Waiting or running
+    bool running() const noexcept;
+    // Finished results per second up to the last one that finished
+    float throughput() const noexcept;
+};
+
+// Response body pretty printed in the background when first displayed
+struct FormattedBody {
+    // TestResult::response_id it was made from, formatted again when the result is rerun
+    size_t response_id = 0;
+    std::atomic<bool> ready = false;
+    std::string body;
+    // Holds the body instead when it's bigger than TEXT_SPILL_SIZE
+    std::unique_ptr<MappedFile> mapped;
+    std::vector<size_t> lines;
+    // Set when the body is json, its nodes point into text()
+    std::optional<JsonTape> tape;
+
+    std::string_view text() const noexcept {
+        return this->mapped ? this->mapped->view() : std::string_view(this->body);
+    }
+};
+
+// Expected and received bodies compared in the background when first displayed
+struct BodyDiff {
+    // TestResult::response_id it was made from, compared again when the result is rerun
+    size_t response_id = 0;
+    std::atomic<bool> ready = false;
+
+    // Json bodies are reformatted the same way so only their values are compared
+    std::string expected;
+    std::string response;
+    std::vector<size_t> expected_lines;
+    std::vector<size_t> response_lines;
+
+    // Collapsed around changes
+    std::vector<DiffRow> rows;
+};
+
 struct TestResult {
     // Can be written and read from any thread
     copy_atomic<bool> running;
@@ -220,6 +286,8 @@ struct TestResult {
     VariablesMap variables;
 
     std::optional<httplib::Result> http_result;
+    // Changed every time http_result is set, addresses of responses can be reused by reruns
+    copy_atomic<size_t> response_id = 0;
 
     // Written only in test_run threads
     std::string verdict = "";
@@ -228,9 +296,17 @@ struct TestResult {
     std::string req_body;
     std::string req_content_type;
     std::string req_endpoint;
+    // Written by the client once the request is sent
+    std::string req_line;
     httplib::Headers req_headers;
 
-    std::string res_body;
+    // Counters of the test and of the whole run, set when added to results
+    std::shared_ptr<ResultCounters> test_counters;
+    std::shared_ptr<ResultCounters> run_counters;
+
+    // Raw body stays in http_result, nullptr until displayed
+    std::shared_ptr<FormattedBody> res_body_formatted;
+    std::shared_ptr<BodyDiff> res_body_diff;
 
     // Progress
     size_t progress_total = 0;
@@ -261,9 +337,10 @@ struct Group {
 
     std::string label() const noexcept;
 
-    void save(SaveState* save) const noexcept;
-    bool can_load(SaveState* save) const noexcept;
-    void load(SaveState* save) noexcept;
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&Group::id, &Group::parent_id, &Group::flags, &Group::name,
+                               &Group::children_ids, &Group::cli_settings, &Group::variables);
+    }
 };
 
 enum NestedTestType : uint8_t {
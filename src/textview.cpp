@@ -0,0 +1,193 @@
+#include "textview.hpp"
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "algorithm"
+#include "cassert"
+#include "cstring"
+#include "filesystem"
+
+MappedFile::~MappedFile() noexcept {
+#ifdef WIN32
+    if (this->data != nullptr) {
+        UnmapViewOfFile(this->data);
+    }
+    if (this->mapping != nullptr) {
+        CloseHandle(this->mapping);
+    }
+    if (this->file != nullptr && this->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(this->file); // Deleted on close
+    }
+#else
+    if (this->data != nullptr) {
+        munmap(const_cast<char*>(this->data), this->size);
+    }
+    if (this->fd >= 0) {
+        close(this->fd);
+    }
+    if (!this->path.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(this->path, ec);
+    }
+#endif
+}
+
+std::unique_ptr<MappedFile> MappedFile::spill(std::string_view text) noexcept {
+    if (text.empty()) {
+        return nullptr; // Empty files can't be mapped
+    }
+
+    auto result = std::make_unique<MappedFile>();
+
+#ifdef WIN32
+    char dir[MAX_PATH + 1];
+    char name[MAX_PATH + 1];
+    if (GetTempPathA(sizeof(dir), dir) == 0 || GetTempFileNameA(dir, "wtb", 0, name) == 0) {
+        return nullptr;
+    }
+    result->path = name;
+
+    result->file = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (result->file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+
+    for (size_t written = 0; written < text.size();) {
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(text.size() - written, 0x40000000));
+        DWORD done = 0;
+        if (!WriteFile(result->file, text.data() + written, chunk, &done, nullptr)) {
+            return nullptr;
+        }
+        written += done;
+    }
+
+    result->mapping = CreateFileMappingA(result->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (result->mapping == nullptr) {
+        return nullptr;
+    }
+
+    result->data = static_cast<const char*>(MapViewOfFile(result->mapping, FILE_MAP_READ, 0, 0, 0));
+    if (result->data == nullptr) {
+        return nullptr;
+    }
+#else
+    std::error_code ec;
+    std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+    if (ec) {
+        return nullptr;
+    }
+    result->path = (dir / "weetee_body_XXXXXX").string();
+
+    result->fd = mkstemp(result->path.data());
+    if (result->fd < 0) {
+        result->path.clear();
+        return nullptr;
+    }
+
+    for (size_t written = 0; written < text.size();) {
+        ssize_t done = write(result->fd, text.data() + written, text.size() - written);
+        if (done <= 0) {
+            return nullptr;
+        }
+        written += static_cast<size_t>(done);
+    }
+
+    void* data = mmap(nullptr, text.size(), PROT_READ, MAP_PRIVATE, result->fd, 0);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    result->data = static_cast<const char*>(data);
+
+    // The mapping keeps the data alive, nothing is left behind if the app crashes
+    std::filesystem::remove(result->path, ec);
+    result->path.clear();
+#endif
+
+    result->size = text.size();
+    return result;
+}
+
+std::vector<size_t> text_line_starts(std::string_view text, size_t max_length) noexcept {
+    assert(max_length > 0);
+
+    std::vector<size_t> result = {0};
+    for (size_t start = 0; start < text.size();) {
+        size_t limit = std::min(text.size() - start, max_length);
+        const char* newline =
+            static_cast<const char*>(std::memchr(text.data() + start, '\n', limit));
+
+        size_t next;
+        if (newline != nullptr) {
+            next = static_cast<size_t>(newline - text.data()) + 1;
+        } else if (start + limit >= text.size()) {
+            break;
+        } else {
+            // Long lines are split, never inside of a utf-8 character
+            next = start + limit;
+            while (next > start + 1 && (static_cast<uint8_t>(text[next]) & 0xc0) == 0x80) {
+                next--;
+            }
+        }
+
+        result.push_back(next);
+        start = next;
+    }
+    return result;
+}
+
+std::string_view text_line(std::string_view text, const std::vector<size_t>& starts,
+                           size_t line) noexcept {
+    assert(line < starts.size());
+
+    size_t start = starts[line];
+    size_t end = line + 1 < starts.size() ? starts[line + 1] : text.size();
+    if (end > start && text[end - 1] == '\n') {
+        end--;
+    }
+    if (end > start && text[end - 1] == '\r') {
+        end--;
+    }
+    return text.substr(start, end - start);
+}
+
+size_t text_line_of(const std::vector<size_t>& starts, size_t offset) noexcept {
+    assert(!starts.empty());
+
+    auto it = std::upper_bound(starts.begin(), starts.end(), offset);
+    return static_cast<size_t>(it - starts.begin()) - 1;
+}
+
+void TextSearch::reset(std::string_view new_query) noexcept {
+    this->query = new_query;
+    this->matches.clear();
+    this->scanned = 0;
+    this->current = 0;
+}
+
+bool TextSearch::step(std::string_view text, size_t budget) noexcept {
+    if (this->query.empty()) {
+        this->scanned = text.size();
+    }
+    if (this->done(text)) {
+        return true;
+    }
+
+    // Matches starting before end are found, the window lets them cross it
+    size_t end = std::min(text.size(), this->scanned + budget);
+    std::string_view window = text.substr(0, std::min(text.size(), end + this->query.size() - 1));
+
+    for (size_t pos = this->scanned;
+         (pos = window.find(this->query, pos)) != std::string_view::npos && pos < end; pos++) {
+        this->matches.push_back(pos);
+    }
+
+    this->scanned = end;
+    return this->done(text);
+}
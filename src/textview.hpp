@@ -0,0 +1,72 @@
+#pragma once
+
+#include "cstddef"
+#include "cstdint"
+#include "memory"
+#include "string"
+#include "string_view"
+#include "vector"
+
+// Bodies bigger than this are moved out of memory into a mapped temporary file
+constexpr size_t TEXT_SPILL_SIZE = 0x800000; // 8 MiB
+// Bytes searched per frame so a search never stalls drawing
+constexpr size_t TEXT_SEARCH_BUDGET = 0x400000; // 4 MiB
+constexpr size_t TEXT_LINE_MAX = 0x1000;
+
+// Read only mapping of a temporary file that is removed when it's destroyed
+struct MappedFile {
+    std::string path;
+    const char* data = nullptr;
+    size_t size = 0;
+
+#ifdef WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    MappedFile() noexcept = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() noexcept;
+
+    std::string_view view() const noexcept { return {this->data, this->size}; }
+
+    // Writes text to a new temporary file and maps it, nullptr when failed
+    static std::unique_ptr<MappedFile> spill(std::string_view text) noexcept;
+};
+
+// Offset of the start of every line, there is always at least one, lines longer than
+// max_length are split so a single line never has to be laid out whole
+std::vector<size_t> text_line_starts(std::string_view text,
+                                     size_t max_length = TEXT_LINE_MAX) noexcept;
+// Line without its line ending
+std::string_view text_line(std::string_view text, const std::vector<size_t>& starts,
+                           size_t line) noexcept;
+// Line containing the offset
+size_t text_line_of(const std::vector<size_t>& starts, size_t offset) noexcept;
+
+// Search that goes through the text a part at a time
+struct TextSearch {
+    std::string query = "";
+    // Offsets of every match found so far in order
+    std::vector<size_t> matches = {};
+    size_t scanned = 0;
+    size_t current = 0;
+
+    void reset(std::string_view query) noexcept;
+    // Searches up to budget more bytes, returns true when the whole text was searched
+    bool step(std::string_view text, size_t budget = TEXT_SEARCH_BUDGET) noexcept;
+    bool done(std::string_view text) const noexcept { return this->scanned >= text.size(); }
+};
+
+struct TextViewState {
+    // Text the state belongs to, the state is reset when another text is shown
+    const void* source = nullptr;
+
+    std::string query = "";
+    TextSearch search = {};
+    // Scroll to the current match once it's found
+    bool jump = false;
+};
@@ -1,5 +1,8 @@
 #include "utils.hpp"
 
+#include "mutex"
+#include "unordered_map"
+
 bool str_contains(const std::string& haystack, const std::string& needle) noexcept {
     size_t need_idx = 0;
     for (char hay : haystack) {
@@ -111,3 +114,66 @@ void find_and_replace(std::string& str, const std::string& to_replace,
         found = str.find(to_replace);
     }
 };
+
+struct StringPool {
+    std::mutex mutex;
+    // Keys point into the pooled strings, entries are erased before their string is deleted
+    std::unordered_map<std::string_view, std::weak_ptr<const std::string>> strings;
+};
+
+// Never destroyed so strings released during static destruction can still unregister
+static StringPool* string_pool() noexcept {
+    static StringPool* pool = new StringPool();
+    return pool;
+}
+
+static const std::shared_ptr<const std::string>& empty_interned_string() noexcept {
+    static const std::shared_ptr<const std::string> empty = std::make_shared<const std::string>();
+    return empty;
+}
+
+static void release_interned_string(const std::string* str) noexcept {
+    StringPool* pool = string_pool();
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+
+        // Same string might have been interned again while this one was expiring
+        auto it = pool->strings.find(*str);
+        if (it != pool->strings.end() && it->first.data() == str->data()) {
+            pool->strings.erase(it);
+        }
+    }
+    delete str;
+}
+
+InternedString::InternedString() noexcept : ptr(empty_interned_string()) {}
+
+InternedString::InternedString(std::string_view str) noexcept {
+    if (str.empty()) {
+        this->ptr = empty_interned_string();
+        return;
+    }
+
+    StringPool* pool = string_pool();
+    std::lock_guard<std::mutex> lock(pool->mutex);
+
+    auto it = pool->strings.find(str);
+    if (it != pool->strings.end()) {
+        this->ptr = it->second.lock();
+        if (this->ptr) {
+            return;
+        }
+
+        // Expired but not yet released, replace the entry
+        pool->strings.erase(it);
+    }
+
+    this->ptr = std::shared_ptr<const std::string>(new std::string(str), release_interned_string);
+    pool->strings.emplace(*this->ptr, this->ptr);
+}
+
+size_t interned_string_count() noexcept {
+    StringPool* pool = string_pool();
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    return pool->strings.size();
+}
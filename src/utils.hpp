@@ -11,7 +11,9 @@
 #include "cassert"
 #include "cmath"
 #include "future"
+#include "memory"
 #include "string"
+#include "string_view"
 #include "variant"
 #include "vector"
 
@@ -157,3 +159,39 @@ template <typename T> struct copy_atomic {
     T load() const noexcept { return this->value.load(); }
     void store(const T& new_value) noexcept { return this->value.store(new_value); }
 };
+
+// Immutable string shared by every equal copy through a global pool
+// Equal interned strings always point to the same data so comparing them is a pointer comparison
+// Unused strings are removed from the pool when the last copy is destroyed
+struct InternedString {
+    std::shared_ptr<const std::string> ptr;
+
+    InternedString() noexcept;
+    InternedString(std::string_view str) noexcept;
+    InternedString(const std::string& str) noexcept : InternedString(std::string_view(str)) {}
+    InternedString(const char* str) noexcept : InternedString(std::string_view(str)) {}
+
+    const std::string& str() const noexcept { return *this->ptr; }
+    operator const std::string&() const noexcept { return *this->ptr; }
+
+    const char* c_str() const noexcept { return this->ptr->c_str(); }
+    size_t length() const noexcept { return this->ptr->length(); }
+    bool empty() const noexcept { return this->ptr->empty(); }
+
+    friend bool operator==(const InternedString& a, const InternedString& b) noexcept {
+        return a.ptr == b.ptr;
+    }
+    friend bool operator==(const InternedString& a, const std::string& b) noexcept {
+        return *a.ptr == b;
+    }
+    friend bool operator==(const InternedString& a, const char* b) noexcept { return *a.ptr == b; }
+};
+
+template <> struct std::hash<InternedString> {
+    size_t operator()(const InternedString& str) const noexcept {
+        return std::hash<const std::string*>()(str.ptr.get());
+    }
+};
+
+// Amount of unique strings currently in the pool
+size_t interned_string_count() noexcept;
@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+
+#include "../../src/chunks.hpp"
+
+#include "filesystem"
+#include "random"
+#include "sstream"
+
+static std::string make_random_data(size_t size, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::string result(size, '\0');
+    for (char& c : result) {
+        c = static_cast<char>(gen() & 0xff);
+    }
+    return result;
+}
+
+static size_t count_files(const std::string& dir) {
+    size_t result = 0;
+    for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(dir)) {
+        result++;
+    }
+    return result;
+}
+
+TEST(chunks, hash) {
+    // Reference values of MurmurHash3_x64_128 with seed 0 as a 128 bit number
+    EXPECT_EQ(chunk_hash("").to_hex(), "00000000000000000000000000000000");
+    EXPECT_EQ(chunk_hash("hello").to_hex(), "5b1e906a48ae1d19cbd8a7b341bd9b02");
+
+    EXPECT_NE(chunk_hash("hello"), chunk_hash("hellp"));
+
+    ChunkHash hash = chunk_hash("The quick brown fox jumps over the lazy dog");
+    EXPECT_EQ(ChunkHash::from_hex(hash.to_hex()), hash);
+    EXPECT_EQ(ChunkHash::from_hex("not a hash"), std::nullopt);
+}
+
+TEST(chunks, boundaries) {
+    std::string data = make_random_data(0x100000, 1);
+    std::vector<size_t> bounds = chunk_boundaries(data);
+
+    ASSERT_FALSE(bounds.empty());
+    EXPECT_EQ(bounds.back(), data.size());
+
+    size_t start = 0;
+    for (size_t i = 0; i < bounds.size(); i++) {
+        size_t size = bounds[i] - start;
+        EXPECT_LE(size, CHUNK_MAX_SIZE);
+        if (i + 1 < bounds.size()) {
+            EXPECT_GE(size, CHUNK_MIN_SIZE);
+        }
+        start = bounds[i];
+    }
+
+    EXPECT_TRUE(chunk_boundaries("").empty());
+    EXPECT_EQ(chunk_boundaries("small"), std::vector<size_t>{5});
+}
+
+TEST(chunks, boundaries_shift) {
+    std::string data = make_random_data(0x40000, 2);
+    std::string edited = data;
+    edited.insert(0x20000, "inserted in the middle");
+
+    std::vector<size_t> bounds = chunk_boundaries(data);
+    std::vector<size_t> edited_bounds = chunk_boundaries(edited);
+
+    // Boundaries are found again shortly after the edit
+    size_t shift = edited.size() - data.size();
+    size_t matching = 0;
+    for (size_t bound : bounds) {
+        if (bound > 0x20000 + CHUNK_MAX_SIZE &&
+            std::find(edited_bounds.begin(), edited_bounds.end(), bound + shift) !=
+                edited_bounds.end()) {
+            matching++;
+        }
+    }
+    EXPECT_GT(matching, 0);
+}
+
+TEST(chunks, manifest) {
+    ChunkManifest manifest{.size = 10, .chunks = {chunk_hash("a"), chunk_hash("b")}};
+
+    std::stringstream ss;
+    EXPECT_TRUE(manifest.write(ss));
+
+    ChunkManifest result{};
+    EXPECT_TRUE(result.read(ss));
+    EXPECT_EQ(result.size, manifest.size);
+    EXPECT_EQ(result.chunks, manifest.chunks);
+
+    std::stringstream invalid("WTCX");
+    EXPECT_FALSE(result.read(invalid));
+}
+
+TEST(chunks, store) {
+    std::string dir = (std::filesystem::temp_directory_path() / "weetee_chunks_test").string();
+    std::filesystem::remove_all(dir);
+
+    ChunkStore store{.dir = dir};
+    std::string data = make_random_data(0x40000, 3);
+
+    auto manifest = store.store(data);
+    ASSERT_TRUE(manifest.has_value());
+    EXPECT_EQ(store.assemble(manifest.value()), data);
+    size_t stored = count_files(dir);
+
+    // Only the chunks around the edit are written
+    std::string edited = data;
+    edited[0x20000] ^= 1;
+    auto edited_manifest = store.store(edited);
+    ASSERT_TRUE(edited_manifest.has_value());
+    EXPECT_EQ(store.assemble(edited_manifest.value()), edited);
+    EXPECT_LE(count_files(dir), stored + 2);
+
+    // Only chunks of the edited version are kept
+    std::unordered_set<ChunkHash> live(edited_manifest->chunks.begin(),
+                                       edited_manifest->chunks.end());
+    EXPECT_GT(store.collect_garbage(live), 0);
+    EXPECT_EQ(store.assemble(edited_manifest.value()), edited);
+    EXPECT_EQ(store.assemble(manifest.value()), std::nullopt);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(chunks, delta) {
+    std::string base = make_random_data(0x40000, 4);
+    std::string target = base;
+    target.insert(0x10000, "inserted");
+    target.erase(0x30000, 0x100);
+    target += "appended";
+
+    std::string delta = delta_encode(base, target);
+    EXPECT_LT(delta.size(), target.size() / 4);
+    EXPECT_EQ(delta_apply(base, delta), target);
+
+    // Made against a different base
+    std::string other = base;
+    other[0] ^= 1;
+    EXPECT_EQ(delta_apply(other, delta), std::nullopt);
+
+    // Corrupted
+    delta.resize(delta.size() - 1);
+    EXPECT_EQ(delta_apply(base, delta), std::nullopt);
+
+    EXPECT_EQ(delta_apply("", delta_encode("", "")), "");
+    EXPECT_EQ(delta_apply("", delta_encode("", "new")), "new");
+}
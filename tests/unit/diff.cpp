@@ -0,0 +1,101 @@
+#include "gtest/gtest.h"
+
+#include "../../src/diff.hpp"
+
+#include "string"
+
+static std::vector<std::string_view> chars(std::string_view text) {
+    std::vector<std::string_view> result;
+    for (size_t i = 0; i < text.size(); i++) {
+        result.push_back(text.substr(i, 1));
+    }
+    return result;
+}
+
+// Applies rows to a and checks they give b, returns the amount of edits
+static size_t apply(const std::vector<std::string_view>& a, const std::vector<std::string_view>& b,
+                    const std::vector<DiffRow>& rows) {
+    std::vector<std::string_view> result;
+    size_t edits = 0;
+    size_t next_a = 0;
+    for (const DiffRow& row : rows) {
+        switch (row.op) {
+        case DIFF_EQUAL:
+            EXPECT_EQ(row.a, next_a++);
+            EXPECT_EQ(a.at(row.a), b.at(row.b));
+            result.push_back(a.at(row.a));
+            break;
+        case DIFF_DELETE:
+            EXPECT_EQ(row.a, next_a++);
+            edits++;
+            break;
+        case DIFF_INSERT:
+            result.push_back(b.at(row.b));
+            edits++;
+            break;
+        case DIFF_SKIP:
+            ADD_FAILURE();
+            break;
+        }
+    }
+    EXPECT_EQ(next_a, a.size());
+    EXPECT_EQ(result, b);
+    return edits;
+}
+
+TEST(diff, diff_lines) {
+    // Example from the paper, the shortest edit script has 5 edits
+    std::vector<std::string_view> a = chars("ABCABBA");
+    std::vector<std::string_view> b = chars("CBABAC");
+    EXPECT_EQ(apply(a, b, diff_lines(a, b)), 5);
+
+    std::vector<std::pair<std::string, std::string>> cases = {
+        {"", ""},
+        {"abc", "abc"},
+        {"", "abc"},
+        {"abc", ""},
+        {"abcdef", "abXdef"},
+        {"abcdefghij", "aXcdYfghZj"},
+        {"xxxxxxxx", "yyyyyy"},
+        {"the quick brown fox", "a quick brown dog jumps"},
+    };
+    for (const auto& [from, to] : cases) {
+        std::vector<std::string_view> from_lines = chars(from);
+        std::vector<std::string_view> to_lines = chars(to);
+        apply(from_lines, to_lines, diff_lines(from_lines, to_lines));
+    }
+
+    std::vector<std::string_view> x = chars("abcdefghij");
+    std::vector<std::string_view> y = chars("aXcdYfghZj");
+    EXPECT_EQ(apply(x, y, diff_lines(x, y)), 6);
+
+    // Over the cost limit the script is still valid, only longer
+    std::vector<std::string_view> left = chars("abababababababababab");
+    std::vector<std::string_view> right = chars("babababababababababa");
+    EXPECT_GE(apply(left, right, diff_lines(left, right, 1)), 2);
+}
+
+TEST(diff, diff_collapse) {
+    std::vector<std::string_view> a = chars("abcdefghijklmnop");
+    std::vector<std::string_view> b = chars("abcdefgXhijklmnop");
+
+    std::vector<DiffRow> rows = diff_collapse(diff_lines(a, b), 2);
+    ASSERT_EQ(rows.size(), 7);
+    EXPECT_EQ(rows[0].op, DIFF_SKIP);
+    EXPECT_EQ(rows[0].skipped, 5);
+    EXPECT_EQ(rows[1].a, 5);
+    EXPECT_EQ(rows[3].op, DIFF_INSERT);
+    EXPECT_EQ(rows[3].b, 7);
+    EXPECT_EQ(rows[6].op, DIFF_SKIP);
+    EXPECT_EQ(rows[6].a, 9);
+    EXPECT_EQ(rows[6].skipped, 7);
+
+    diff_expand(&rows, 6);
+    ASSERT_EQ(rows.size(), 13);
+    EXPECT_EQ(rows[6].op, DIFF_EQUAL);
+    EXPECT_EQ(rows[12].a, 15);
+    EXPECT_EQ(rows[12].b, 16);
+
+    // Nothing worth hiding
+    EXPECT_EQ(diff_collapse(diff_lines(chars("abc"), chars("aXc")), 2).size(), 4);
+}
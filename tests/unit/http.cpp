@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+#include "../../src/http.hpp"
+
+TEST(http, glob_match) {
+    EXPECT_TRUE(glob_match("*", ""));
+    EXPECT_TRUE(glob_match("*", "anything"));
+    EXPECT_TRUE(glob_match("application/*", "application/json"));
+    EXPECT_TRUE(glob_match("a?c", "abc"));
+    EXPECT_TRUE(glob_match("*b*b*", "abcbd"));
+    EXPECT_TRUE(glob_match("max-age=\\*", "max-age=*"));
+
+    EXPECT_FALSE(glob_match("application/*", "text/json"));
+    EXPECT_FALSE(glob_match("a?c", "ac"));
+    EXPECT_FALSE(glob_match("*b*b*", "abcd"));
+    EXPECT_FALSE(glob_match("max-age=\\*", "max-age=10"));
+}
+
+TEST(http, header_matcher) {
+    httplib::Headers headers = {
+        {"Content-Type", "application/json; charset=utf-8"},
+        {"Set-Cookie", "session=abc; Path=/"},
+        {"Set-Cookie", "theme=dark"},
+        {"X-Request-Id", "req-1234"},
+    };
+
+    HeaderMatcher matcher;
+    EXPECT_TRUE(matcher.add("content-type", "application/json"));
+    EXPECT_TRUE(matcher.add("SET-COOKIE", "theme=dark"));
+    EXPECT_TRUE(matcher.add("Set-Cookie", "glob:session=*"));
+    EXPECT_TRUE(matcher.add("X-Request-Id", "regex:^req-[0-9]+$"));
+    EXPECT_EQ(matcher.match(headers), nullptr);
+
+    EXPECT_TRUE(matcher.add("X-Request-Id", "regex:^[0-9]+$"));
+    const HeaderPattern* missing = matcher.match(headers);
+    ASSERT_NE(missing, nullptr);
+    EXPECT_EQ(missing->value, "regex:^[0-9]+$");
+
+    HeaderMatcher missing_header;
+    EXPECT_TRUE(missing_header.add("ETag", ""));
+    EXPECT_NE(missing_header.match(headers), nullptr);
+
+    HeaderMatcher invalid;
+    EXPECT_FALSE(invalid.add("X-Request-Id", "regex:["));
+    EXPECT_EQ(invalid.invalid, "X-Request-Id");
+}
+
+TEST(http, header_matcher_values) {
+    httplib::Headers headers = {
+        {"Location", "/login?next=/home"},
+        {"Cache-Control", "max-age=*"},
+        {"Content-Type", "application/json"},
+    };
+
+    // Wildcards are only special in globs
+    HeaderMatcher contains;
+    EXPECT_TRUE(contains.add("Location", "/login?next="));
+    EXPECT_TRUE(contains.add("Cache-Control", "max-age=\\*"));
+    EXPECT_TRUE(contains.add("Cache-Control", "max-age=*"));
+    EXPECT_EQ(contains.match(headers), nullptr);
+
+    // Slashes around a value are part of it
+    HeaderMatcher slashes;
+    EXPECT_TRUE(slashes.add("Location", "/login?next=/"));
+    EXPECT_TRUE(slashes.add("Location", "/login?next=/home"));
+    EXPECT_TRUE(slashes.add("Content-Type", "/json"));
+    EXPECT_EQ(slashes.match(headers), nullptr);
+    EXPECT_TRUE(slashes.add("Location", "/a(b/"));
+    EXPECT_TRUE(slashes.invalid.empty());
+    EXPECT_NE(slashes.match(headers), nullptr);
+
+    HeaderMatcher literal;
+    EXPECT_TRUE(literal.add("Content-Type", "application/*"));
+    EXPECT_NE(literal.match(headers), nullptr);
+
+    HeaderMatcher glob;
+    EXPECT_TRUE(glob.add("Content-Type", "glob:application/*"));
+    EXPECT_TRUE(glob.add("Location", "glob:/login?next=*"));
+    EXPECT_TRUE(glob.add("Cache-Control", "glob:max-age=\\*"));
+    EXPECT_EQ(glob.match(headers), nullptr);
+
+    HeaderMatcher whole;
+    EXPECT_TRUE(whole.add("Location", "glob:/login"));
+    EXPECT_NE(whole.match(headers), nullptr);
+}
+
+TEST(http, header_matcher_cache) {
+    HeaderMatcherCache cache;
+    httplib::Headers expected = {{"X-Request-Id", "regex:^req-[0-9]+$"}};
+
+    std::shared_ptr<const HeaderMatcher> matcher = cache.get(expected);
+    ASSERT_NE(matcher, nullptr);
+    EXPECT_TRUE(matcher->invalid.empty());
+    EXPECT_EQ(cache.get(expected), matcher);
+    EXPECT_NE(cache.get({{"X-Request-Id", "req"}}), matcher);
+
+    EXPECT_EQ(cache.get({{"ETag", "regex:["}})->invalid, "ETag");
+}
@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "../../src/json.hpp"
 
+#include "sstream"
+
 TEST(json, json_format) {
     std::string input = R"json({"test": [1, "one", true]})json";
     std::string expected = R"json(
@@ -33,4 +35,160 @@ TEST(json, json_compare) {
     EXPECT_STREQ(json_compare(valid, invalid), "Invalid Response JSON");
     EXPECT_STREQ(json_compare(valid, different), "Unexpected Response JSON");
     EXPECT_EQ(json_compare(valid, valid), nullptr);
+    // Invalid part after the difference
+    EXPECT_STREQ(json_compare(valid, different + ","), "Invalid Response JSON");
+}
+
+TEST(json, json_writer) {
+    nlohmann::json expected = R"json({
+        "empty": {},
+        "list": [1, {"nested": ["a\nb", []]}],
+        "name": "test"
+    })json"_json;
+
+    std::stringstream ss;
+    JsonWriter writer = {.os = &ss, .indent = 2};
+    writer.begin_object();
+    writer.key("empty");
+    writer.begin_object();
+    writer.end_object();
+    writer.key("list");
+    writer.begin_array();
+    writer.value(1);
+    writer.value(expected.at("list").at(1));
+    writer.end_array();
+    writer.key("name");
+    writer.value("test");
+    writer.end_object();
+
+    EXPECT_EQ(ss.str(), expected.dump(2));
+}
+
+TEST(json, json_compare_path) {
+    nlohmann::json expected = R"json({
+        "id": 1,
+        "items": [{"name": "a"}, {"name": "b", "tags": ["x"]}],
+        "float": 1.0
+    })json"_json;
+
+    std::string path;
+    EXPECT_EQ(json_compare(expected, R"json({"float": 1, "items": [{"name": "a"},
+        {"tags": ["x"], "name": "b"}], "id": 1})json", &path), nullptr);
+
+    EXPECT_STREQ(json_compare(expected, R"json({"id": 2})json", &path),
+                 "Unexpected Response JSON");
+    EXPECT_EQ(path, "/id");
+
+    EXPECT_STREQ(json_compare(expected, R"json({"id": 1, "items": [{"name": "a"},
+        {"name": "b", "tags": ["y"]}]})json", &path), "Unexpected Response JSON");
+    EXPECT_EQ(path, "/items/1/tags/0");
+
+    // Missing and extra keys
+    EXPECT_STREQ(json_compare(expected, R"json({"id": 1, "float": 1,
+        "items": [{"name": "a"}, {"name": "b"}]})json", &path), "Unexpected Response JSON");
+    EXPECT_EQ(path, "/items/1/tags");
+    EXPECT_STREQ(json_compare(expected, R"json({"id": 1, "other": 1})json", &path),
+                 "Unexpected Response JSON");
+    EXPECT_EQ(path, "/other");
+
+    // Duplicate keys keep the last value
+    nlohmann::json single = R"json({"a": 1})json"_json;
+    EXPECT_EQ(json_compare(single, R"json({"a": 1, "a": 2, "a": 1})json", &path), nullptr);
+    EXPECT_EQ(path, "");
+    EXPECT_STREQ(json_compare(single, R"json({"a": 1, "a": 2})json", &path),
+                 "Unexpected Response JSON");
+    EXPECT_EQ(path, "/a");
+    // Comparison stops before it sees the duplicate
+    EXPECT_STREQ(json_compare(single, R"json({"a": 2, "a": 1})json", &path),
+                 "Unexpected Response JSON");
+    EXPECT_EQ(path, "/a");
+
+    // Extra array element
+    EXPECT_STREQ(json_compare(expected, R"json({"id": 1, "items": [{"name": "a"},
+        {"name": "b", "tags": ["x"]}, 3]})json", &path), "Unexpected Response JSON");
+    EXPECT_EQ(path, "/items/2");
+
+    EXPECT_STREQ(json_compare(expected, R"json({"id": 1, )json", &path), "Invalid Response JSON");
+}
+
+TEST(json, json_cache) {
+    JsonCache cache;
+
+    std::shared_ptr<const nlohmann::json> document = cache.get(R"json({"a": 1})json");
+    ASSERT_NE(document, nullptr);
+    EXPECT_EQ(document->at("a"), 1);
+    EXPECT_EQ(cache.get(R"json({"a": 1})json"), document);
+
+    EXPECT_EQ(cache.get("["), nullptr);
+}
+
+TEST(json, json_tape) {
+    JsonTape tape;
+    std::string text;
+    ASSERT_TRUE(
+        tape.parse(R"json({"id": 1, "items": [1.50, "a\n", null], "ok": true})json", &text));
+    ASSERT_EQ(tape.nodes.size(), 7);
+
+    const JsonTapeNode& root = tape.nodes[0];
+    EXPECT_EQ(root.type, JSON_TAPE_OBJECT);
+    EXPECT_EQ(root.size, 3);
+    EXPECT_EQ(root.end, 7);
+    EXPECT_EQ(tape.text(text, root), text);
+
+    const JsonTapeNode& items = tape.nodes[2];
+    EXPECT_EQ(tape.key(text, items), "items");
+    EXPECT_EQ(items.size, 3);
+    EXPECT_EQ(items.end, 6);
+
+    // Numbers keep how they are written, strings as they are in the text
+    EXPECT_EQ(tape.text(text, tape.nodes[3]), "1.50");
+    EXPECT_EQ(tape.text(text, tape.nodes[4]), R"("a\n")");
+    EXPECT_EQ(tape.key(text, tape.nodes[4]), "");
+    EXPECT_EQ(tape.key(text, tape.nodes[6]), "ok");
+
+    // Nested values are copied as if they were the whole document
+    EXPECT_EQ(tape.dump(text, 2, 1), "[\n    1.50,\n    \"a\\n\",\n    null\n]");
+
+    EXPECT_FALSE(tape.parse(R"json({"id": )json", &text));
+    EXPECT_TRUE(tape.nodes.empty());
+    EXPECT_TRUE(text.empty());
+}
+
+TEST(json, json_tape_formatted) {
+    // Same as dump apart from key order
+    for (std::string input : {
+             R"json({"b": {"c": [], "d": {}}, "a": [1, -2, [true, false]], "e": "\u00e9\"\t"})json",
+             R"json([])json",
+             R"json("text")json",
+             R"json([{"x": null}, {}, [[]]])json",
+         }) {
+        JsonTape tape;
+        std::string text;
+        ASSERT_TRUE(tape.parse(input, &text));
+        EXPECT_EQ(text, nlohmann::ordered_json::parse(input).dump(4));
+    }
+}
+
+TEST(json, json_tree_rows) {
+    JsonTape tape;
+    std::string text;
+    ASSERT_TRUE(tape.parse(R"json({"a": [1, [2, 3]], "b": {"c": 4}})json", &text));
+
+    // Only the root is open at first
+    JsonTreeState state;
+    state.update(tape);
+    ASSERT_EQ(state.rows.size(), 3);
+    EXPECT_EQ(tape.key(text, tape.nodes[state.rows[1].node]), "a");
+    EXPECT_EQ(tape.key(text, tape.nodes[state.rows[2].node]), "b");
+
+    state.toggle(state.rows[1].node);
+    state.update(tape);
+    ASSERT_EQ(state.rows.size(), 5);
+    EXPECT_EQ(state.rows[2].depth, 2);
+    EXPECT_EQ(state.rows[3].index, 1);
+    EXPECT_EQ(tape.nodes[state.rows[3].node].type, JSON_TAPE_ARRAY);
+
+    state.toggle(state.rows[1].node);
+    state.update(tape);
+    EXPECT_EQ(state.rows.size(), 3);
 }
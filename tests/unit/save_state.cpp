@@ -1,6 +1,8 @@
 #include "../../src/save_state.hpp"
 #include "gtest/gtest.h"
 
+#include "sstream"
+
 struct TestData {
     std::variant<int32_t, std::string> id = 103;
     std::string name = "Sasha";
@@ -57,6 +59,31 @@ struct TestData {
     }
 };
 
+struct FieldsTestData {
+    uint8_t flags = 3;
+    std::string endpoint = "http://localhost:8000/path";
+    std::vector<InternedString> keys = {"Accept", "Accept", "Host"};
+    std::vector<int64_t> points = {0, 2, 3, 5};
+    std::optional<TestData> nested = TestData{};
+    std::variant<std::monostate, std::string> id = "uuid";
+    std::string added_later = "new field";
+
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&FieldsTestData::flags,
+                               save_field_endpoint(&FieldsTestData::endpoint),
+                               &FieldsTestData::keys, &FieldsTestData::points,
+                               &FieldsTestData::nested, &FieldsTestData::id,
+                               save_field_since<4>(&FieldsTestData::added_later));
+    }
+
+    bool operator==(const FieldsTestData& other) const noexcept {
+        return this->flags == other.flags && this->endpoint == other.endpoint &&
+               this->keys == other.keys && this->points == other.points &&
+               this->nested.has_value() == other.nested.has_value() && this->id == other.id &&
+               this->added_later == other.added_later;
+    }
+};
+
 bool operator==(const TestData& first, const TestData& second) {
     return first.id == second.id && first.name == second.name &&
            first.password == second.password && first.points == second.points &&
@@ -147,3 +174,192 @@ TEST(save_state, load_alt_data) {
     ss.load(got);
     EXPECT_EQ(input, got);
 }
+
+TEST(save_state, stream) {
+    TestData input = {
+        .name = std::string(SAVE_STATE_CHUNK_SIZE * 3 + 7, 'a'),
+        .points = std::vector<int64_t>(SAVE_STATE_CHUNK_SIZE / 3, 5),
+    };
+
+    std::stringstream stream;
+    SaveState ss = {};
+    ASSERT_TRUE(ss.begin_stream(&stream));
+    ss.save(input);
+    ASSERT_TRUE(ss.finish_stream());
+    EXPECT_TRUE(ss.original_buffer.empty());
+
+    SaveState read = {};
+    ASSERT_TRUE(read.read(stream));
+    EXPECT_EQ(read.original_size, ss.original_size);
+
+    TestData got = {};
+    ASSERT_TRUE(read.can_load(got) && read.load_idx == read.original_size);
+    read.reset_load();
+    read.load(got);
+    EXPECT_EQ(input, got);
+}
+
+TEST(save_state, write_read) {
+    TestData input = {};
+
+    SaveState ss = {};
+    ss.save(input);
+    ss.finish_save();
+
+    std::stringstream stream;
+    ASSERT_TRUE(ss.write(stream));
+
+    SaveState read = {};
+    ASSERT_TRUE(read.read(stream));
+    EXPECT_EQ(read.original_buffer, ss.original_buffer);
+
+    // Truncated files fail instead of loading partially
+    std::string truncated = stream.str();
+    truncated.resize(truncated.size() - sizeof(size_t) - 1);
+    std::stringstream truncated_stream(truncated);
+    EXPECT_FALSE(read.read(truncated_stream));
+}
+
+TEST(save_state, read_version_2) {
+    TestData input = {};
+
+    SaveState ss = {};
+    ss.save(input);
+    ss.finish_save();
+
+    std::stringstream stream;
+    size_t version = 2;
+    stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    stream.write(reinterpret_cast<const char*>(&ss.original_size), sizeof(ss.original_size));
+    stream.write(ss.original_buffer.data(), static_cast<std::streamsize>(ss.original_size));
+
+    SaveState read = {};
+    ASSERT_TRUE(read.read(stream));
+    EXPECT_EQ(read.save_version, 2);
+
+    TestData got = {};
+    ASSERT_TRUE(read.can_load(got) && read.load_idx == read.original_size);
+    read.reset_load();
+    read.load(got);
+    EXPECT_EQ(input, got);
+}
+
+TEST(save_state, string_table) {
+    std::vector<InternedString> input = {"Accept", "Content-Type", "Accept", "Accept", ""};
+    std::string endpoint = "https://example.com/pets/{id}";
+    std::string other_endpoint = "https://example.com/users";
+
+    std::stringstream stream;
+    SaveState ss = {};
+    ASSERT_TRUE(ss.begin_stream(&stream));
+    ss.save(input);
+    ss.save_endpoint(endpoint);
+    ss.save_endpoint(other_endpoint);
+    ASSERT_TRUE(ss.finish_stream());
+
+    // Accept, Content-Type, empty, host and both paths
+    EXPECT_EQ(ss.strings.size(), 6);
+
+    SaveState read = {};
+    ASSERT_TRUE(read.read(stream));
+    EXPECT_EQ(read.strings.size(), 6);
+
+    std::vector<InternedString> got;
+    std::string got_endpoint, got_other_endpoint;
+    ASSERT_TRUE(read.can_load(got) && read.can_load_endpoint(got_endpoint) &&
+                read.can_load_endpoint(got_other_endpoint) &&
+                read.load_idx == read.original_size);
+    read.reset_load();
+    read.load(got);
+    read.load_endpoint(got_endpoint);
+    read.load_endpoint(got_other_endpoint);
+
+    EXPECT_EQ(input, got);
+    EXPECT_EQ(got[0].ptr, got[2].ptr);
+    EXPECT_EQ(endpoint, got_endpoint);
+    EXPECT_EQ(other_endpoint, got_other_endpoint);
+
+    // Index outside of the table
+    read.reset_load();
+    read.strings.pop_back();
+    EXPECT_FALSE(read.can_load(got) && read.can_load_endpoint(got_endpoint) &&
+                 read.can_load_endpoint(got_other_endpoint));
+}
+
+TEST(save_state, save_fields) {
+    FieldsTestData input = {
+        .flags = 5,
+        .points = {1, 2},
+        .nested = std::nullopt,
+        .added_later = "changed",
+    };
+
+    SaveState ss = {};
+    ss.reserve(input);
+    ss.save(input);
+    // Exact size is known for field lists
+    EXPECT_EQ(ss.original_buffer.size(), SaveState::save_size(input));
+    EXPECT_EQ(ss.original_buffer.capacity(), SaveState::save_size(input));
+    ss.finish_save();
+    ss.reset_load();
+
+    FieldsTestData got = {};
+    ASSERT_TRUE(ss.can_load(got) && ss.load_idx == ss.original_size);
+    ss.reset_load();
+    ss.load(got);
+    EXPECT_EQ(input, got);
+}
+
+struct SinceTestData {
+    std::string name = "name";
+    int32_t added_later = 5;
+
+    static constexpr auto save_fields() noexcept {
+        return std::make_tuple(&SinceTestData::name,
+                               save_field_since<4>(&SinceTestData::added_later));
+    }
+};
+
+TEST(save_state, save_field_since) {
+    // Older save only has the name
+    SaveState ss = {};
+    ss.save(std::string("old"));
+    ss.finish_save();
+    ss.save_version = 3;
+
+    SinceTestData got = {};
+    ASSERT_TRUE(ss.can_load(got) && ss.load_idx == ss.original_size);
+    ss.reset_load();
+    ss.load(got);
+    EXPECT_EQ(got.name, "old");
+    EXPECT_EQ(got.added_later, 5);
+
+    ss.reset_load();
+    ss.save_version = SAVE_STATE_VERSION;
+    EXPECT_FALSE(ss.can_load(got));
+}
+
+TEST(save_state, undo_history) {
+    TestData data = {};
+    UndoHistory history(&data);
+    size_t generation = history.generation;
+    std::shared_ptr<const SaveState> snapshot = history.current();
+
+    data.name = "changed";
+    history.push_undo_history(&data);
+    EXPECT_NE(history.generation, generation);
+    EXPECT_NE(history.current(), snapshot);
+
+    history.undo(&data);
+    EXPECT_EQ(data.name, "Sasha");
+    EXPECT_EQ(history.current(), snapshot);
+
+    // Snapshots stay valid after history changes
+    history.reset_undo_history(&data);
+    TestData got = {.name = ""};
+    SaveState copy = *snapshot;
+    ASSERT_TRUE(copy.can_load(got));
+    copy.reset_load();
+    copy.load(got);
+    EXPECT_EQ(got, data);
+}
@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+
+#include "../../src/search.hpp"
+
+static std::vector<size_t> ids(const std::vector<SearchMatch>& matches) {
+    std::vector<size_t> result;
+    for (const SearchMatch& match : matches) {
+        if (result.empty() || result.back() != match.id) {
+            result.push_back(match.id);
+        }
+    }
+    return result;
+}
+
+TEST(search, index) {
+    SearchIndex index;
+    index.set(1, {{.kind = SEARCH_ENDPOINT, .text = "/api/v1/Users"},
+                  {.kind = SEARCH_HEADER, .text = "X-Request-Id: abc"}});
+    index.set(2, {{.kind = SEARCH_ENDPOINT, .text = "/api/v1/items"},
+                  {.kind = SEARCH_BODY, .text = "{\"userName\": \"a\"}"}});
+    index.set(3, {{.kind = SEARCH_NAME, .text = "Users"}});
+
+    EXPECT_EQ(ids(index.search("users")), (std::vector<size_t>{1, 3}));
+    EXPECT_EQ(ids(index.search("USER")), (std::vector<size_t>{1, 2, 3}));
+    EXPECT_EQ(ids(index.search("x-request")), (std::vector<size_t>{1}));
+    EXPECT_EQ(ids(index.search("missing")), (std::vector<size_t>{}));
+
+    // Every trigram is present but not in this order
+    EXPECT_EQ(ids(index.search("/v1/api")), (std::vector<size_t>{}));
+
+    // Short queries are compared against every document
+    EXPECT_EQ(ids(index.search("v1")), (std::vector<size_t>{1, 2}));
+    EXPECT_EQ(ids(index.search("")), (std::vector<size_t>{1, 2, 3}));
+
+    std::vector<SearchMatch> matches = index.search("user", SEARCH_KIND_BODY);
+    ASSERT_EQ(matches.size(), 1);
+    EXPECT_EQ(matches[0].id, 2);
+    EXPECT_EQ(matches[0].field, 1);
+}
+
+TEST(search, update) {
+    SearchIndex index;
+    index.set(1, {{.kind = SEARCH_ENDPOINT, .text = "/old"}});
+    index.set(2, {{.kind = SEARCH_ENDPOINT, .text = "/old/two"}});
+
+    index.set(1, {{.kind = SEARCH_ENDPOINT, .text = "/new"}});
+    EXPECT_EQ(ids(index.search("old")), (std::vector<size_t>{2}));
+    EXPECT_EQ(ids(index.search("new")), (std::vector<size_t>{1}));
+
+    index.erase(2);
+    EXPECT_EQ(ids(index.search("old")), (std::vector<size_t>{}));
+    EXPECT_FALSE(index.contains(2));
+    EXPECT_EQ(index.documents.size(), 1);
+
+    // Nothing is left behind by removed documents
+    index.erase(1);
+    EXPECT_TRUE(index.postings.empty());
+}
+
+TEST(search, find) {
+    EXPECT_EQ(search_find("Content-Type: JSON", "type"), 8);
+    EXPECT_EQ(search_find("Content-Type: JSON", "xml"), std::string::npos);
+    EXPECT_EQ(search_find("abc", ""), 0);
+    EXPECT_EQ(search_find("", "a"), std::string::npos);
+}
+
+TEST(search, tokens) {
+    EXPECT_EQ(search_tokens("{\"Error\": \"E_TIMEOUT\", \"id\": 42, \"Error\": 1}"),
+              (std::vector<std::string>{"1", "42", "e_timeout", "error", "id"}));
+    EXPECT_EQ(search_tokens(" .-: "), (std::vector<std::string>{}));
+
+    // Words cut between parts are put back together
+    SearchTokenizer tokenizer;
+    tokenizer.feed("Content-Ty");
+    tokenizer.feed("pe: applica");
+    tokenizer.feed("tion/json");
+    EXPECT_EQ(tokenizer.finish(),
+              (std::vector<std::string>{"application", "content", "json", "type"}));
+    EXPECT_TRUE(tokenizer.finish().empty());
+
+    std::string long_word(SEARCH_TOKEN_MAX * 2, 'a');
+    std::string start(SEARCH_TOKEN_MAX, 'a');
+    EXPECT_EQ(search_tokens(long_word), (std::vector<std::string>{start}));
+}
+
+TEST(search, token_index) {
+    SearchTokenIndex index;
+    index.set(1, search_tokens("HTTP/1.1 500\n{\"error\": \"internal\", \"id\": 7781}"));
+    index.set(2, search_tokens("HTTP/1.1 200\n{\"id\": 7782, \"name\": \"errors\"}"));
+    index.set(3, search_tokens("HTTP/1.1 404\nnot found"));
+
+    EXPECT_EQ(index.search("7781"), (std::vector<size_t>{1}));
+    // Words match by their start
+    EXPECT_EQ(index.search("778"), (std::vector<size_t>{1, 2}));
+    EXPECT_EQ(index.search("ERROR"), (std::vector<size_t>{1, 2}));
+    // Every word has to be found
+    EXPECT_EQ(index.search("error 500"), (std::vector<size_t>{1}));
+    EXPECT_EQ(index.search("error 404"), (std::vector<size_t>{}));
+    EXPECT_EQ(index.search("missing"), (std::vector<size_t>{}));
+    EXPECT_EQ(index.search(" "), (std::vector<size_t>{}));
+
+    index.set(1, search_tokens("HTTP/1.1 200"));
+    EXPECT_EQ(index.search("7781"), (std::vector<size_t>{}));
+    EXPECT_EQ(index.search("200"), (std::vector<size_t>{1, 2}));
+
+    // Nothing is left behind by removed documents
+    index.erase(1);
+    index.erase(2);
+    index.erase(3);
+    EXPECT_TRUE(index.postings.empty());
+    EXPECT_TRUE(index.documents.empty());
+}
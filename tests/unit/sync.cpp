@@ -0,0 +1,374 @@
+#include "gtest/gtest.h"
+
+#include "../../src/chunks.hpp"
+#include "../../src/sync.hpp"
+
+#include "../../external/json/single_include/nlohmann/json.hpp"
+
+#include "filesystem"
+#include "map"
+#include "optional"
+#include "thread"
+
+// Stand-in for the sync server keeping files in memory
+struct SyncServer {
+    httplib::Server server;
+    std::thread thread;
+    int port = 0;
+
+    std::map<std::string, std::string> files;
+    bool supports_delta = true;
+    bool supports_batch_delete = true;
+    size_t full_uploads = 0;
+    size_t delta_uploads = 0;
+    size_t not_modified = 0;
+    size_t delete_requests = 0;
+    // Files are moved to another path when set, prefixed with this host if not empty
+    std::optional<std::string> redirect = std::nullopt;
+
+    struct Upload {
+        std::string name;
+        std::string hash;
+        size_t size;
+        std::string data;
+    };
+    std::map<std::string, Upload> uploads;
+    bool supports_upload_pieces = true;
+    size_t piece_requests = 0;
+    // Simulates failures on these piece requests
+    size_t lose_piece = SIZE_MAX;
+    size_t lose_reply = SIZE_MAX;
+
+    SyncServer() {
+        auto get_file = [this](const httplib::Request& req, httplib::Response& res) {
+            auto it = this->files.find(req.get_param_value("file_name"));
+            if (it == this->files.end()) {
+                res.status = 404;
+                return;
+            }
+
+            std::string etag = '"' + sync_content_hash(it->second) + '"';
+            if (req.get_header_value("If-None-Match") == etag) {
+                this->not_modified++;
+                res.status = 304;
+                return;
+            }
+
+            res.set_header("ETag", etag);
+            res.set_content(it->second, "application/octet-stream");
+        };
+        this->server.Get("/file-moved", get_file);
+        this->server.Get("/file", [this, get_file](const httplib::Request& req,
+                                                   httplib::Response& res) {
+            if (this->redirect.has_value()) {
+                res.status = 302;
+                res.set_header("Location", this->redirect.value() +
+                                               httplib::append_query_params("/file-moved",
+                                                                            req.params));
+                return;
+            }
+            get_file(req, res);
+        });
+
+        this->server.Post("/file", [this](const httplib::Request& req, httplib::Response& res) {
+            this->full_uploads++;
+            this->files[req.get_param_value("file_name")] = req.body;
+            res.status = 200;
+        });
+
+        this->server.Post("/file-delta", [this](const httplib::Request& req,
+                                                httplib::Response& res) {
+            std::string name = req.get_param_value("file_name");
+            std::string base_name =
+                req.has_param("base_name") ? req.get_param_value("base_name") : name;
+            auto it = this->files.find(base_name);
+            if (!this->supports_delta) {
+                res.status = 404;
+                return;
+            }
+            if (it == this->files.end() ||
+                sync_content_hash(it->second) != req.get_param_value("base_hash")) {
+                res.status = 409;
+                return;
+            }
+
+            std::optional<std::string> applied = delta_apply(it->second, req.body);
+            if (!applied.has_value()) {
+                res.status = 400;
+                return;
+            }
+
+            this->delta_uploads++;
+            this->files[name] = std::move(applied.value());
+            res.status = 200;
+        });
+
+        this->server.Delete("/file", [this](const httplib::Request& req, httplib::Response& res) {
+            this->delete_requests++;
+            res.status = this->files.erase(req.get_param_value("file_name")) > 0 ? 200 : 404;
+        });
+
+        this->server.Post("/file-batch-delete", [this](const httplib::Request& req,
+                                                       httplib::Response& res) {
+            if (!this->supports_batch_delete) {
+                res.status = 404;
+                return;
+            }
+
+            this->delete_requests++;
+            for (const std::string& name : nlohmann::json::parse(req.body)) {
+                this->files.erase(name);
+            }
+            res.status = 200;
+        });
+
+        this->server.Post("/file-upload", [this](const httplib::Request& req,
+                                                 httplib::Response& res) {
+            if (!this->supports_upload_pieces) {
+                res.status = 404;
+                return;
+            }
+
+            std::string id = std::to_string(this->uploads.size());
+            this->uploads[id] = Upload{
+                .name = req.get_param_value("file_name"),
+                .hash = req.get_param_value("hash"),
+                .size = std::stoull(req.get_param_value("size")),
+                .data = "",
+            };
+            res.set_content(id, "text/plain");
+        });
+
+        this->server.Put("/file-upload", [this](const httplib::Request& req,
+                                                httplib::Response& res) {
+            size_t request = this->piece_requests++;
+            Upload& upload = this->uploads.at(req.get_param_value("upload_id"));
+            if (request == this->lose_piece ||
+                std::stoull(req.get_param_value("offset")) != upload.data.size()) {
+                res.status = 500;
+                return;
+            }
+
+            upload.data += req.body;
+            res.status = request == this->lose_reply ? 500 : 200;
+        });
+
+        this->server.Get("/file-upload", [this](const httplib::Request& req,
+                                                httplib::Response& res) {
+            const Upload& upload = this->uploads.at(req.get_param_value("upload_id"));
+            res.set_content(std::to_string(upload.data.size()), "text/plain");
+        });
+
+        this->server.Post("/file-upload-finish", [this](const httplib::Request& req,
+                                                        httplib::Response& res) {
+            const Upload& upload = this->uploads.at(req.get_param_value("upload_id"));
+            if (upload.data.size() != upload.size ||
+                sync_content_hash(upload.data) != upload.hash) {
+                res.status = 400;
+                return;
+            }
+
+            this->full_uploads++;
+            this->files[upload.name] = upload.data;
+            res.status = 200;
+        });
+
+        this->port = this->server.bind_to_any_port("127.0.0.1");
+        this->thread = std::thread([this]() { this->server.listen_after_bind(); });
+        this->server.wait_until_ready();
+    }
+
+    ~SyncServer() {
+        this->server.stop();
+        this->thread.join();
+    }
+
+    std::string host() const { return "http://127.0.0.1:" + std::to_string(this->port); }
+};
+
+static std::string make_data(size_t size) {
+    std::string result;
+    result.reserve(size);
+    for (size_t i = 0; result.size() < size; i++) {
+        result += "{\"id\":" + std::to_string(i) + ",\"endpoint\":\"/api/v1/items\"}\n";
+    }
+    return result;
+}
+
+TEST(sync, upload) {
+    SyncServer server;
+    httplib::Client cli(server.host());
+    httplib::Params params = {{"file_name", "test.wt"}};
+
+    std::string data = make_data(0x40000);
+    EXPECT_EQ(sync_upload(cli, params, data), "");
+    EXPECT_EQ(server.full_uploads, 1);
+
+    std::string edited = data;
+    edited.replace(0x20000, 4, "edit");
+    EXPECT_EQ(sync_upload(cli, params, edited, data), "");
+    EXPECT_EQ(server.delta_uploads, 1);
+    EXPECT_EQ(server.files["test.wt"], edited);
+
+    // Base is outdated so the whole file is sent instead
+    std::string other = edited + "more";
+    EXPECT_EQ(sync_upload(cli, params, other, data), "");
+    EXPECT_EQ(server.full_uploads, 2);
+    EXPECT_EQ(server.files["test.wt"], other);
+
+    // New file made from another one
+    EXPECT_EQ(sync_upload(cli, {{"file_name", "copy.wt"}}, edited, other, "test.wt"), "");
+    EXPECT_EQ(server.delta_uploads, 2);
+    EXPECT_EQ(server.files["copy.wt"], edited);
+    EXPECT_EQ(server.files["test.wt"], other);
+
+    server.supports_delta = false;
+    EXPECT_EQ(sync_upload(cli, params, edited, other), "");
+    EXPECT_EQ(server.full_uploads, 3);
+    EXPECT_EQ(server.files["test.wt"], edited);
+}
+
+TEST(sync, upload_pieces) {
+    SyncServer server;
+    httplib::Client cli(server.host());
+    httplib::Params params = {{"file_name", "big.wt"}};
+
+    std::string data = make_data(SYNC_UPLOAD_PIECE_SIZE * 3 + 10);
+    EXPECT_EQ(sync_upload(cli, params, data), "");
+    EXPECT_EQ(server.piece_requests, 4);
+    EXPECT_EQ(server.files["big.wt"], data);
+
+    // Resumed from what the server received
+    server.piece_requests = 0;
+    server.lose_piece = 1;
+    server.lose_reply = 2;
+    EXPECT_EQ(sync_upload_pieces(cli, params, data), "");
+    EXPECT_EQ(server.piece_requests, 5);
+    EXPECT_EQ(server.files["big.wt"], data);
+
+    // Small files are sent whole
+    server.piece_requests = 0;
+    EXPECT_EQ(sync_upload(cli, {{"file_name", "small.wt"}}, "small"), "");
+    EXPECT_EQ(server.piece_requests, 0);
+    EXPECT_EQ(server.files["small.wt"], "small");
+
+    server.supports_upload_pieces = false;
+    EXPECT_EQ(sync_upload_pieces(cli, params, data), std::nullopt);
+    EXPECT_EQ(sync_upload(cli, params, data + "new"), "");
+    EXPECT_EQ(server.files["big.wt"], data + "new");
+}
+
+TEST(sync, download) {
+    SyncServer server;
+    httplib::Client cli(server.host());
+    httplib::Params params = {{"file_name", "test.wt"}};
+
+    std::string data = make_data(0x1000);
+    server.files["test.wt"] = data;
+
+    std::string error;
+    EXPECT_EQ(sync_download(cli, params, std::nullopt, &error), data);
+    EXPECT_EQ(server.not_modified, 0);
+
+    EXPECT_EQ(sync_download(cli, params, data, &error), data);
+    EXPECT_EQ(server.not_modified, 1);
+
+    // Cached copy is outdated
+    EXPECT_EQ(sync_download(cli, params, data + "old", &error), data);
+    EXPECT_EQ(server.not_modified, 1);
+
+    httplib::Params missing = {{"file_name", "missing.wt"}};
+    EXPECT_EQ(sync_download(cli, missing, std::nullopt, &error), std::nullopt);
+    EXPECT_FALSE(error.empty());
+}
+
+TEST(sync, download_redirect) {
+    SyncServer server;
+    httplib::Client cli(server.host());
+    httplib::Params params = {{"file_name", "test.wt"}};
+
+    std::string data = make_data(0x1000);
+    server.files["test.wt"] = data;
+
+    // Cached copies are still checked at the new location
+    std::string error;
+    for (std::string redirect : {std::string(""), server.host()}) {
+        server.redirect = redirect;
+        size_t not_modified = server.not_modified;
+
+        EXPECT_EQ(sync_download(cli, params, std::nullopt, &error), data);
+        EXPECT_EQ(sync_download(cli, params, data, &error), data);
+        EXPECT_EQ(server.not_modified, not_modified + 1);
+        EXPECT_EQ(sync_download(cli, params, data + "old", &error), data);
+        EXPECT_EQ(server.not_modified, not_modified + 1);
+    }
+}
+
+TEST(sync, delete) {
+    SyncServer server;
+    httplib::Client cli(server.host());
+
+    server.files = {{"a", ""}, {"b", ""}, {"c", ""}, {"d", ""}, {"e", ""}};
+
+    EXPECT_EQ(sync_delete(cli, {}, {"a", "b"}), "");
+    EXPECT_EQ(server.delete_requests, 1);
+    EXPECT_EQ(server.files.size(), 3);
+
+    server.supports_batch_delete = false;
+    EXPECT_EQ(sync_delete(cli, {}, {"c", "d"}), "");
+    EXPECT_EQ(server.delete_requests, 3);
+    EXPECT_EQ(server.files.size(), 1);
+
+    EXPECT_NE(sync_delete(cli, {}, {"missing"}), "");
+    EXPECT_EQ(sync_delete(cli, {}, {}), "");
+}
+
+TEST(sync, client_pool) {
+    SyncClientPool pool;
+
+    httplib::Client* first;
+    {
+        SyncClient cli(&pool, "http://127.0.0.1:1");
+        first = &*cli;
+    }
+    EXPECT_EQ(pool.idle.size(), 1);
+
+    // Idle client is reused
+    {
+        SyncClient cli(&pool, "http://127.0.0.1:1");
+        EXPECT_EQ(&*cli, first);
+        EXPECT_EQ(pool.idle.size(), 0);
+
+        // Concurrent users get their own
+        SyncClient other(&pool, "http://127.0.0.1:1");
+        EXPECT_NE(&*other, first);
+    }
+    EXPECT_EQ(pool.idle.size(), 2);
+
+    // Changing the host drops old connections
+    {
+        SyncClient cli(&pool, "http://127.0.0.1:2");
+        EXPECT_EQ(pool.idle.size(), 0);
+    }
+    EXPECT_EQ(pool.idle.size(), 1);
+}
+
+TEST(sync, cache) {
+    std::string dir = (std::filesystem::temp_directory_path() / "weetee_sync_test").string();
+    std::filesystem::remove_all(dir);
+
+    SyncCache cache{.dir = dir};
+    EXPECT_EQ(cache.get("file"), std::nullopt);
+
+    EXPECT_TRUE(cache.put("file", "data"));
+    EXPECT_EQ(cache.get("file"), "data");
+
+    cache.rename("file", "renamed");
+    EXPECT_EQ(cache.get("file"), std::nullopt);
+    EXPECT_EQ(cache.get("renamed"), "data");
+
+    cache.erase("renamed");
+    EXPECT_EQ(cache.get("renamed"), std::nullopt);
+
+    std::filesystem::remove_all(dir);
+}
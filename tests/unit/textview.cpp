@@ -0,0 +1,75 @@
+#include "gtest/gtest.h"
+
+#include "../../src/textview.hpp"
+
+TEST(textview, lines) {
+    std::string text = "first\r\nsecond\n\nlast";
+    std::vector<size_t> starts = text_line_starts(text);
+
+    ASSERT_EQ(starts, (std::vector<size_t>{0, 7, 14, 15}));
+    EXPECT_EQ(text_line(text, starts, 0), "first");
+    EXPECT_EQ(text_line(text, starts, 1), "second");
+    EXPECT_EQ(text_line(text, starts, 2), "");
+    EXPECT_EQ(text_line(text, starts, 3), "last");
+
+    EXPECT_EQ(text_line_of(starts, 0), 0);
+    EXPECT_EQ(text_line_of(starts, 6), 0);
+    EXPECT_EQ(text_line_of(starts, 7), 1);
+    EXPECT_EQ(text_line_of(starts, 18), 3);
+
+    std::vector<size_t> single = text_line_starts("");
+    EXPECT_EQ(single.size(), 1);
+    EXPECT_EQ(text_line("", single, 0), "");
+
+    std::vector<size_t> trailing = text_line_starts("a\n");
+    ASSERT_EQ(trailing.size(), 2);
+    EXPECT_EQ(text_line("a\n", trailing, 1), "");
+}
+
+TEST(textview, search) {
+    std::string text = "abcabcab abca";
+
+    TextSearch search;
+    search.reset("abca");
+
+    // Matches crossing the end of a step are still found
+    EXPECT_FALSE(search.step(text, 2));
+    EXPECT_EQ(search.matches, (std::vector<size_t>{0}));
+    EXPECT_FALSE(search.step(text, 2));
+    EXPECT_EQ(search.matches, (std::vector<size_t>{0, 3}));
+    EXPECT_TRUE(search.step(text, 100));
+    EXPECT_EQ(search.matches, (std::vector<size_t>{0, 3, 9}));
+    EXPECT_TRUE(search.done(text));
+
+    search.reset("missing");
+    EXPECT_TRUE(search.step(text));
+    EXPECT_TRUE(search.matches.empty());
+
+    search.reset("");
+    EXPECT_TRUE(search.step(text));
+    EXPECT_TRUE(search.matches.empty());
+}
+
+TEST(textview, spill) {
+    std::string text(0x10000, 'x');
+    text += "end";
+
+    std::unique_ptr<MappedFile> file = MappedFile::spill(text);
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(file->view(), text);
+
+    EXPECT_EQ(MappedFile::spill(""), nullptr);
+}
+
+TEST(textview, long_lines) {
+    std::string text = "abcdefgh\nab\xc3\xa9" "cd";
+    std::vector<size_t> starts = text_line_starts(text, 3);
+
+    // The second byte of é is never the start of a line
+    ASSERT_EQ(starts, (std::vector<size_t>{0, 3, 6, 9, 11, 14}));
+    EXPECT_EQ(text_line(text, starts, 1), "def");
+    EXPECT_EQ(text_line(text, starts, 2), "gh");
+    EXPECT_EQ(text_line(text, starts, 3), "ab");
+    EXPECT_EQ(text_line(text, starts, 4), "\xc3\xa9" "c");
+    EXPECT_EQ(text_line(text, starts, 5), "d");
+}
@@ -66,3 +66,24 @@ TEST(utils, MapKeyIterator) {
         EXPECT_TRUE(map.contains(*it));
     }
 }
+
+TEST(utils, InternedString) {
+    size_t count = interned_string_count();
+    {
+        InternedString a = "Content-Type";
+        InternedString b = std::string("Content-Type");
+        InternedString c = "Accept";
+
+        EXPECT_EQ(a, b);
+        EXPECT_EQ(a.ptr, b.ptr);
+        EXPECT_NE(a, c);
+        EXPECT_EQ(a, "Content-Type");
+        EXPECT_EQ(c, std::string("Accept"));
+        EXPECT_EQ(interned_string_count(), count + 2);
+
+        EXPECT_TRUE(InternedString().empty());
+        EXPECT_EQ(InternedString(), InternedString(""));
+    }
+    // Released when last copy is gone
+    EXPECT_EQ(interned_string_count(), count);
+}